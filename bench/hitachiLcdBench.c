@@ -0,0 +1,617 @@
+/*******************************************************************************
+ * @file    hitachiLcdBench.c
+ * @author  Jay Convertino(electrobs@gmail.com)
+ * @date    2024.03.11
+ * @brief   Bus time and throughput benchmark of the hitachi LCD library
+ * @details Runs every public call against the host HD44780 model and prints
+ *          one CSV line per call and configuration. Time is emulated time:
+ *          delays plus port accesses, instruction overhead of the AVR is not
+ *          included, so cycles = us * F_CPU / 1000000. ready_us is the time
+ *          until the controller has finished the last byte of the call.
+ * @version 0.6.0
+ *
+ * @license mit
+ *
+ * Copyright 2024 Johnathan Convertino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hitachiLcd.h"
+#include "hd44780Model.h"
+
+#ifdef HITACHI_LCD_STATIC
+#include "hitachiLcdConfig.h"
+#endif
+
+//wiring used for every configuration, data on PORTD, RS/E/RW on PORTB 0/1/2
+#define BENCH_RS  0
+#define BENCH_ENA 1
+#define BENCH_RW  2
+
+//how the display is wired up
+#define BENCH_CONTIGUOUS 0
+#define BENCH_STATIC     1
+#define BENCH_MAP        2
+#define BENCH_PCF8574    3
+#define BENCH_HC595      4
+
+//74HC595 RCLK on PORTB 0
+#define BENCH_LATCH 0
+
+//backpack address and bus clock
+#define BENCH_TWI_ADDR 0x27
+#define BENCH_TWI_SCL  400000UL
+
+/**
+ * @struct s_benchConfig
+ * @brief One bus and screen combination
+ */
+struct s_benchConfig
+{
+  const char *p_name;
+  uint8_t mode;
+  uint8_t rw;
+  uint8_t rows;
+  uint8_t cols;
+  uint8_t wiring;
+  uint8_t batch;
+};
+
+/**
+ * @struct s_benchCase
+ * @brief One measured call, prepare runs before the measurement starts
+ */
+struct s_benchCase
+{
+  const char *p_name;
+  void (*prepare)(struct s_lcd *p_lcd, const struct s_benchConfig *p_config);
+  void (*run)(struct s_lcd *p_lcd, const struct s_benchConfig *p_config);
+};
+
+//mapped data lines, D0-D3 on PC1 PC2 PD0 PD1, D4-D7 on PC5 PD2 PC0 PD7
+static volatile uint8_t * const gp_mapPorts[8] = {&PORTC, &PORTC, &PORTD, &PORTD, &PORTC, &PORTD, &PORTC, &PORTD};
+static const uint8_t g_mapBits[8] = {1, 2, 0, 1, 5, 2, 0, 7};
+
+//panels sharing data and RS, each with its own enable on PORTB 3 and up
+#define BENCH_GROUP 4
+
+static struct s_lcdMap g_map;
+static uint8_t g_batch[64];
+static uint8_t g_groupShadow[BENCH_GROUP][4 * 40];
+static uint8_t g_groupDirty[BENCH_GROUP][LCD_SHADOW_DIRTY_SIZE(4, 40)];
+static uint8_t g_shadow[4 * 40];
+static uint8_t g_dirty[LCD_SHADOW_DIRTY_SIZE(4, 40)];
+static char g_row[41];
+static uint16_t g_queue[64];
+static struct s_lcdMarquee g_marquee;
+static struct s_lcdBar g_bar;
+static struct s_lcdBig g_big;
+static struct s_lcdWindow g_window;
+
+//degree sign and a two row screen layout kept in flash
+static const uint8_t g_degree[8] PROGMEM = {0x06, 0x09, 0x09, 0x06, 0x00, 0x00, 0x00, 0x00};
+static const uint8_t * const gp_glyphs[] = {g_degree};
+static const uint8_t g_screen[] PROGMEM =
+{
+  LCD_SCR_AT(0, 0), 'T', 'e', 'm', 'p', ':', LCD_SCR_FIELD_OF(0, 5), LCD_SCR_GLYPH_OF(0), 'C',
+  LCD_SCR_AT(1, 0), 'R', 'H', ':', LCD_SCR_FIELD_OF(1, 3), '%',
+  LCD_SCR_END
+};
+
+static void benchField(struct s_lcd *p_lcd, uint8_t field, uint8_t width)
+{
+  if(field == 0) printFixedLCD(p_lcd, 0x1580, 8, 1, width, 0);
+  else printUnsignedLCD(p_lcd, 40, 10, width, 0);
+}
+
+//init for the wiring of the configuration, the models are already attached
+static void benchInit(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+#ifdef HITACHI_LCD_STATIC
+  if(p_config->wiring == BENCH_STATIC)
+  {
+    initLCD_static(p_lcd, p_config->rows * p_config->cols, p_config->rows, 2, 10);
+    return;
+  }
+#endif
+
+  if(p_config->wiring == BENCH_PCF8574)
+  {
+    initLCD_twi(p_lcd, pcf8574ModelSend, BENCH_TWI_ADDR, g_batch, p_config->batch, p_config->rows * p_config->cols, p_config->rows, 2, 10);
+    setTwiClockLCD(p_lcd, BENCH_TWI_SCL);
+  }
+  else if(p_config->wiring == BENCH_HC595)
+  {
+    initLCD_spi(p_lcd, &PORTB, BENCH_LATCH, p_config->mode, p_config->rows * p_config->cols, p_config->rows, 2, 10);
+  }
+  else if(p_config->wiring == BENCH_MAP)
+  {
+    initLCD_map(p_lcd, &g_map, &PORTB, BENCH_RS, BENCH_ENA, (p_config->rw ? BENCH_RW : LCD_NO_RW), p_config->mode, p_config->rows * p_config->cols, p_config->rows, 2, 10);
+  }
+  else
+  {
+    initLCD_customRW(p_lcd, &PORTD, &PORTB, BENCH_RS, BENCH_ENA, (p_config->rw ? BENCH_RW : LCD_NO_RW), p_config->mode, p_config->rows * p_config->cols, p_config->rows, 2, 10);
+  }
+}
+
+static void prepareNone(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_lcd; (void)p_config;}
+
+static void prepareShadow(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  attachShadowLCD(p_lcd, g_shadow, g_dirty, p_config->rows, p_config->cols);
+  printShadowLCD(p_lcd, 0, 0, "Temp: 21.5C");
+}
+
+static void prepareShadowFlushed(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  prepareShadow(p_lcd, p_config);
+  flushLCD(p_lcd);
+  printShadowLCD(p_lcd, 0, 6, "22.7");
+}
+
+static void prepareService(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  (void)p_config;
+  attachQueueLCD(p_lcd, g_queue, 64, LCD_QUEUE_DROP);
+  printLCD(p_lcd, "Temp: 21.5C");
+  //first call only starts the clock
+  serviceLCD(p_lcd, (uint16_t)(hostStats.timeNs / 1000));
+}
+
+//restart after a soft reset, probe the controller when R/W is wired, take it on trust otherwise
+static void prepareWarm(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  (void)p_lcd;
+  setInitModeLCD(p_config->rw ? LCD_INIT_PROBE : LCD_INIT_WARM);
+}
+
+//marquee over the first row, stepped once so the step measured is a steady one
+static void prepareMarqueeShift(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  (void)p_config;
+  startMarqueeLCD(p_lcd, &g_marquee, 0, 0, 0, "Next train 12:45 platform 3", 4, LCD_MARQUEE_SHIFT);
+  stepMarqueeLCD(p_lcd, &g_marquee);
+}
+
+static void prepareMarqueeRow(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  (void)p_config;
+  startMarqueeLCD(p_lcd, &g_marquee, 1, 0, 0, "Next train 12:45 platform 3", 4, LCD_MARQUEE_ROW);
+  stepMarqueeLCD(p_lcd, &g_marquee);
+}
+
+//bar part way into a cell, its glyphs already loaded, the call moves it one pixel
+static void prepareBar(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  startBarLCD(p_lcd, &g_bar, p_config->rows - 1, 0, p_config->cols, LCD_BAR_HORIZONTAL);
+  setBarLCD(p_lcd, &g_bar, 13);
+  setBarLCD(p_lcd, &g_bar, 12);
+}
+
+//counter in big digits, glyphs already loaded, the call counts it up by one
+static void prepareBig(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  (void)p_config;
+  startBigLCD(p_lcd, &g_big, &g_lcdBigFont2x2, 0, 0, 4);
+  printBigLCD(p_lcd, &g_big, 1235, 0);
+  printBigLCD(p_lcd, &g_big, 1234, 0);
+}
+
+//status line on the first row, a scrolling log below it with every row written
+static void prepareWindow(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  prepareShadow(p_lcd, p_config);
+  openWindowLCD(p_lcd, &g_window, 1, 0, 0, 0, LCD_WIN_SCROLL);
+  printWindowLCD(p_lcd, &g_window, "12:00 boot\n12:01 link up\n12:02 sensor ok");
+  flushLCD(p_lcd);
+}
+
+//flushed screen with a cell written behind the shadow's back, the scrub finds and repairs it
+static void prepareScrub(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  prepareShadow(p_lcd, p_config);
+  flushLCD(p_lcd);
+  setCursorLCD(p_lcd, 0, 1);
+  printLCD(p_lcd, "#");
+}
+
+static void prepareCursor(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  (void)p_config;
+  setCursorLCD(p_lcd, 1, 0);
+  printLCD(p_lcd, "Temp:");
+}
+
+static void runInit(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {benchInit(p_lcd, p_config);}
+
+static void runPrintRow(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  memset(g_row, 'A', p_config->cols);
+  g_row[p_config->cols] = '\0';
+
+  printLCD(p_lcd, g_row);
+}
+
+static void runPrintScreen(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  uint8_t row = 0;
+
+  //whole screen in one call, the rows are reached by wrapping
+  homeLCD(p_lcd);
+
+  for(row = 0; row < p_config->rows; row++)
+  {
+    memset(g_row, 'A' + row, p_config->cols);
+    g_row[p_config->cols] = '\0';
+
+    printLCD(p_lcd, g_row);
+  }
+}
+
+static void runPrintFlash(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; printLCD_P(p_lcd, PSTR("Temp: 21.5C"));}
+static void runScreen(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; runScreenLCD(p_lcd, g_screen, gp_glyphs, sizeof(gp_glyphs) / sizeof(gp_glyphs[0]), benchField);}
+
+static void runService(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; serviceLCD(p_lcd, (uint16_t)(hostStats.timeNs / 1000));}
+
+static void runStream(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  FILE stream;
+  FILE *p_stream = openStreamLCD(p_lcd, &stream);
+
+  (void)p_config;
+
+  fprintf(p_stream, "\rT: %d.%dC\nRH: %d%%", 21, 5, 40);
+  fclose(p_stream);
+}
+
+static void runPrintSpecial(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; printSpecialLCD(p_lcd, 0x01);}
+static void runPrintInt(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; printIntLCD(p_lcd, -12345);}
+static void runPrintDec(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; printDecLCD(p_lcd, 3.14159);}
+static void runPrintSigned(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; printSignedLCD(p_lcd, -12345, 10, 8, 0);}
+static void runPrintHex(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; printHexLCD(p_lcd, 0xBEEF, 4, LCD_FMT_ZERO);}
+static void runPrintFixed(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; printFixedLCD(p_lcd, 0x0324, 8, 2, 0, 0);}
+static void runSetCursor(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; setCursorLCD(p_lcd, 1, 5);}
+static void runClear(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; clearLCD(p_lcd);}
+static void runHome(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; homeLCD(p_lcd);}
+static void runScrollLeft(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; scrollDisplayLeftLCD(p_lcd);}
+static void runScrollRight(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; scrollDisplayRightLCD(p_lcd);}
+static void runDisplayOff(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; displayOffLCD(p_lcd);}
+static void runDisplayOn(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; displayOnLCD(p_lcd);}
+static void runCursorOn(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; cursorOnLCD(p_lcd);}
+static void runCursorOff(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; cursorOffLCD(p_lcd);}
+static void runBlinkOn(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; blinkOnLCD(p_lcd);}
+static void runBlinkOff(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; blinkOffLCD(p_lcd);}
+static void runLeftToRight(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; leftToRightLCD(p_lcd);}
+static void runRightToLeft(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; rightToLeftLCD(p_lcd);}
+static void runAutoscrollOn(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; autoscrollOnLCD(p_lcd);}
+static void runAutoscrollOff(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; autoscrollOffLCD(p_lcd);}
+static void runMarquee(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; stepMarqueeLCD(p_lcd, &g_marquee);}
+static void runBar(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; setBarLCD(p_lcd, &g_bar, 13);}
+static void runBig(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; printBigLCD(p_lcd, &g_big, 1235, 0);}
+static void runScrub(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; scrubLCD(p_lcd, 500);}
+static void runWindow(struct s_lcd *p_lcd, const struct s_benchConfig *p_config)
+{
+  (void)p_config;
+  printWindowLCD(p_lcd, &g_window, "\n12:03 alarm");
+  flushLCD(p_lcd);
+}
+
+static void runFlush(struct s_lcd *p_lcd, const struct s_benchConfig *p_config) {(void)p_config; flushLCD(p_lcd);}
+
+static const struct s_benchConfig g_configs[] =
+{
+  {"4bit_16x2",      0, 0, 2, 16},
+  {"4bit_20x4",      0, 0, 4, 20},
+  {"8bit_16x2",      1, 0, 2, 16},
+  {"8bit_20x4",      1, 0, 4, 20},
+  {"4bit_busy_16x2", 0, 1, 2, 16},
+  {"4bit_busy_20x4", 0, 1, 4, 20},
+  {"8bit_busy_16x2", 1, 1, 2, 16},
+  {"8bit_busy_20x4", 1, 1, 4, 20},
+  {"4bit_map_16x2",  0, 0, 2, 16, BENCH_MAP},
+  {"8bit_map_16x2",  1, 0, 2, 16, BENCH_MAP},
+  {"4bit_busy_map_16x2", 0, 1, 2, 16, BENCH_MAP},
+  {"pcf8574_nibble_16x2", 0, 0, 2, 16, BENCH_PCF8574, 2},
+  {"pcf8574_16x2",   0, 0, 2, 16, BENCH_PCF8574, 64},
+  {"pcf8574_20x4",   0, 0, 4, 20, BENCH_PCF8574, 64},
+  {"hc595_4bit_16x2", 0, 0, 2, 16, BENCH_HC595},
+  {"hc595_8bit_16x2", 1, 0, 2, 16, BENCH_HC595},
+  {"hc595_8bit_20x4", 1, 0, 4, 20, BENCH_HC595},
+#ifdef HITACHI_LCD_STATIC
+#ifdef LCD_STATIC_RW
+  {"static_busy_16x2", LCD_STATIC_MODE, 1, 2, 16, BENCH_STATIC},
+#else
+  {"static_16x2",    LCD_STATIC_MODE, 0, 2, 16, BENCH_STATIC},
+#endif
+#endif
+};
+
+static const struct s_benchCase g_cases[] =
+{
+  {"initLCD_cold",        prepareNone,          runInit},
+  {"initLCD_warm",        prepareWarm,          runInit},
+  {"printLCD_row",        prepareNone,          runPrintRow},
+  {"printLCD_screen",     prepareNone,          runPrintScreen},
+  {"fprintf_stream",      prepareNone,          runStream},
+  {"printLCD_P",          prepareNone,          runPrintFlash},
+  {"runScreenLCD",        prepareNone,          runScreen},
+  {"serviceLCD_step",     prepareService,       runService},
+  {"printSpecialLCD",     prepareNone,          runPrintSpecial},
+  {"printIntLCD",         prepareNone,          runPrintInt},
+  {"printDecLCD",         prepareNone,          runPrintDec},
+  {"printSignedLCD",      prepareNone,          runPrintSigned},
+  {"printHexLCD",         prepareNone,          runPrintHex},
+  {"printFixedLCD",       prepareNone,          runPrintFixed},
+  {"setCursorLCD",        prepareNone,          runSetCursor},
+  {"setCursorLCD_noop",   prepareCursor,        runSetCursor},
+  {"clearLCD",            prepareNone,          runClear},
+  {"homeLCD",             prepareNone,          runHome},
+  {"scrollDisplayLeftLCD",  prepareNone,        runScrollLeft},
+  {"scrollDisplayRightLCD", prepareNone,        runScrollRight},
+  {"displayOffLCD",       prepareNone,          runDisplayOff},
+  {"displayOnLCD",        prepareNone,          runDisplayOn},
+  {"cursorOnLCD",         prepareNone,          runCursorOn},
+  {"cursorOffLCD",        prepareNone,          runCursorOff},
+  {"blinkOnLCD",          prepareNone,          runBlinkOn},
+  {"blinkOffLCD",         prepareNone,          runBlinkOff},
+  {"leftToRightLCD",      prepareNone,          runLeftToRight},
+  {"rightToLeftLCD",      prepareNone,          runRightToLeft},
+  {"autoscrollOnLCD",     prepareNone,          runAutoscrollOn},
+  {"autoscrollOffLCD",    prepareNone,          runAutoscrollOff},
+  {"flushLCD_full",       prepareShadow,        runFlush},
+  {"flushLCD_4cells",     prepareShadowFlushed, runFlush},
+  {"stepMarqueeLCD_shift", prepareMarqueeShift, runMarquee},
+  {"stepMarqueeLCD_row",  prepareMarqueeRow,    runMarquee},
+  {"printWindowLCD_log",  prepareWindow,        runWindow},
+  {"setBarLCD_pixel",     prepareBar,           runBar},
+  {"printBigLCD_count",   prepareBig,           runBig},
+  {"scrubLCD_500us",      prepareScrub,         runScrub},
+};
+
+//run one case on a freshly initialized display and print its CSV line
+static void benchCase(const struct s_benchConfig *p_config, const struct s_benchCase *p_case)
+{
+  struct s_lcd lcd;
+  struct s_hd44780Model model;
+  struct s_hd44780Model before;
+  struct s_pcf8574Model expander;
+  struct s_hc595Model shifter[2];
+  uint64_t startNs = 0;
+  uint64_t irqOffNs = 0;
+  uint64_t elapsedNs = 0;
+  uint64_t readyNs = 0;
+
+  hostReset();
+
+  hd44780ModelInit(&model, HD44780_FOSC_HZ);
+
+#ifdef HITACHI_LCD_STATIC
+  //wired the way hitachiLcdConfig.h says
+  if(p_config->wiring == BENCH_STATIC)
+  {
+#ifdef LCD_STATIC_RW
+    hd44780ModelWireParallel(&model, &LCD_STATIC_DATA_PORT, &LCD_STATIC_CTRL_PORT, LCD_STATIC_RS, LCD_STATIC_ENA, LCD_STATIC_RW, LCD_STATIC_MODE);
+#else
+    hd44780ModelWireParallel(&model, &LCD_STATIC_DATA_PORT, &LCD_STATIC_CTRL_PORT, LCD_STATIC_RS, LCD_STATIC_ENA, 0xFF, LCD_STATIC_MODE);
+#endif
+    hd44780ModelAttach(&model);
+  }
+  else
+#endif
+  if(p_config->wiring == BENCH_PCF8574)
+  {
+    pcf8574ModelInit(&expander, BENCH_TWI_ADDR, BENCH_TWI_SCL);
+    pcf8574ModelAttach(&expander);
+    hd44780ModelWirePcf8574(&model, &expander);
+    hd44780ModelAttach(&model);
+  }
+  else if(p_config->wiring == BENCH_HC595)
+  {
+    hc595ModelInit(&shifter[0], &PORTB, BENCH_LATCH);
+    hc595ModelInit(&shifter[1], &PORTB, BENCH_LATCH);
+
+    if(p_config->mode) hc595ModelChain(&shifter[0], &shifter[1]);
+
+    hc595ModelAttach(&shifter[0]);
+    hd44780ModelWireHc595(&model, &shifter[0], (p_config->mode ? &shifter[1] : NULL));
+    hd44780ModelAttach(&model);
+  }
+  else if(p_config->wiring == BENCH_MAP)
+  {
+    uint8_t line = 0;
+
+    for(line = (p_config->mode ? 0 : 4); line < 8; line++)
+    {
+      hd44780ModelWire(&model, HD44780_D0 + line, gp_mapPorts[line], g_mapBits[line]);
+      g_map.p_data[line] = gp_mapPorts[line];
+      g_map.dataBit[line] = g_mapBits[line];
+    }
+
+    hd44780ModelWire(&model, HD44780_RS, &PORTB, BENCH_RS);
+    hd44780ModelWire(&model, HD44780_E, &PORTB, BENCH_ENA);
+
+    if(p_config->rw) hd44780ModelWire(&model, HD44780_RW, &PORTB, BENCH_RW);
+
+    hd44780ModelAttach(&model);
+  }
+  else
+  {
+    hd44780ModelWireParallel(&model, &PORTD, &PORTB, BENCH_RS, BENCH_ENA, (p_config->rw ? BENCH_RW : 0xFF), p_config->mode);
+    hd44780ModelAttach(&model);
+  }
+
+  setInitModeLCD(LCD_INIT_COLD);
+  benchInit(&lcd, p_config);
+
+  p_case->prepare(&lcd, p_config);
+
+  //let anything from init or prepare finish so it isn't billed to the call
+  _delay_ms(2);
+  hostIrqSync();
+
+  before = model;
+  startNs = hostStats.timeNs;
+  irqOffNs = hostStats.irqOffNs;
+  hostStats.irqOffMaxNs = 0;
+
+  p_case->run(&lcd, p_config);
+
+  hostIrqSync();
+
+  elapsedNs = hostStats.timeNs - startNs;
+  irqOffNs = hostStats.irqOffNs - irqOffNs;
+  //with busy flag polling the wait for the last command moves into the next call
+  readyNs = ((model.busyUntilNs > hostStats.timeNs) ? model.busyUntilNs : hostStats.timeNs) - startNs;
+
+  printf("%s,%s,%llu,%.3f,%.3f,%u,%u,%u,%u,%.3f,%.3f,%u\n",
+    p_case->p_name,
+    p_config->p_name,
+    (unsigned long long)((elapsedNs * (F_CPU / 1000000UL)) / 1000),
+    elapsedNs / 1000.0,
+    readyNs / 1000.0,
+    (model.instructions - before.instructions),
+    (model.dataWrites - before.dataWrites),
+    (model.reads - before.reads),
+    (model.strobes - before.strobes),
+    irqOffNs / 1000.0,
+    hostStats.irqOffMaxNs / 1000.0,
+    (model.busyViolations - before.busyViolations) + (model.timingViolations - before.timingViolations));
+}
+
+//full refresh of BENCH_GROUP panels on one bus, one after the other or interleaved
+static void benchGroup(const struct s_benchConfig *p_config, uint8_t interleave)
+{
+  struct s_lcd lcd[BENCH_GROUP];
+  struct s_lcd *p_group[BENCH_GROUP];
+  struct s_hd44780Model model[BENCH_GROUP];
+  struct s_hd44780Model before[BENCH_GROUP];
+  uint32_t instructions = 0;
+  uint32_t dataWrites = 0;
+  uint32_t reads = 0;
+  uint32_t strobes = 0;
+  uint32_t violations = 0;
+  uint64_t startNs = 0;
+  uint64_t irqOffNs = 0;
+  uint64_t elapsedNs = 0;
+  uint64_t readyNs = 0;
+  uint8_t index = 0;
+  uint8_t row = 0;
+
+  hostReset();
+
+  for(index = 0; index < BENCH_GROUP; index++)
+  {
+    hd44780ModelInit(&model[index], HD44780_FOSC_HZ);
+    hd44780ModelWireParallel(&model[index], &PORTD, &PORTB, BENCH_RS, BENCH_RW + 1 + index, (p_config->rw ? BENCH_RW : 0xFF), p_config->mode);
+    hd44780ModelAttach(&model[index]);
+  }
+
+  for(index = 0; index < BENCH_GROUP; index++)
+  {
+    initLCD_customRW(&lcd[index], &PORTD, &PORTB, BENCH_RS, BENCH_RW + 1 + index, (p_config->rw ? BENCH_RW : LCD_NO_RW), p_config->mode, p_config->rows * p_config->cols, p_config->rows, 2, 10);
+    attachShadowLCD(&lcd[index], g_groupShadow[index], g_groupDirty[index], p_config->rows, p_config->cols);
+
+    for(row = 0; row < p_config->rows; row++)
+    {
+      memset(g_row, 'A' + index, p_config->cols);
+      g_row[p_config->cols] = '\0';
+      printShadowLCD(&lcd[index], row, 0, g_row);
+    }
+
+    p_group[index] = &lcd[index];
+  }
+
+  _delay_ms(2);
+  hostIrqSync();
+
+  memcpy(before, model, sizeof(before));
+
+  startNs = hostStats.timeNs;
+  irqOffNs = hostStats.irqOffNs;
+  hostStats.irqOffMaxNs = 0;
+
+  if(interleave)
+  {
+    flushGroupLCD(p_group, BENCH_GROUP);
+  }
+  else
+  {
+    for(index = 0; index < BENCH_GROUP; index++) flushLCD(&lcd[index]);
+  }
+
+  hostIrqSync();
+
+  elapsedNs = hostStats.timeNs - startNs;
+  irqOffNs = hostStats.irqOffNs - irqOffNs;
+  readyNs = hostStats.timeNs;
+
+  for(index = 0; index < BENCH_GROUP; index++)
+  {
+    instructions += model[index].instructions - before[index].instructions;
+    dataWrites += model[index].dataWrites - before[index].dataWrites;
+    reads += model[index].reads - before[index].reads;
+    strobes += model[index].strobes - before[index].strobes;
+    violations += (model[index].busyViolations - before[index].busyViolations) + (model[index].timingViolations - before[index].timingViolations);
+
+    if(model[index].busyUntilNs > readyNs) readyNs = model[index].busyUntilNs;
+  }
+
+  printf("%s,%s_x%u,%llu,%.3f,%.3f,%u,%u,%u,%u,%.3f,%.3f,%u\n",
+    (interleave ? "flushGroupLCD" : "flushLCD_each"),
+    p_config->p_name,
+    BENCH_GROUP,
+    (unsigned long long)((elapsedNs * (F_CPU / 1000000UL)) / 1000),
+    elapsedNs / 1000.0,
+    (readyNs - startNs) / 1000.0,
+    instructions,
+    dataWrites,
+    reads,
+    strobes,
+    irqOffNs / 1000.0,
+    hostStats.irqOffMaxNs / 1000.0,
+    violations);
+}
+
+int main(void)
+{
+  size_t config = 0;
+  size_t test = 0;
+
+  printf("api,config,cycles,us,ready_us,instructions,data,reads,strobes,irq_off_us,irq_off_max_us,violations\n");
+
+  for(config = 0; config < (sizeof(g_configs) / sizeof(g_configs[0])); config++)
+  {
+    for(test = 0; test < (sizeof(g_cases) / sizeof(g_cases[0])); test++)
+    {
+      benchCase(&g_configs[config], &g_cases[test]);
+    }
+
+    if(g_configs[config].wiring == BENCH_CONTIGUOUS)
+    {
+      benchGroup(&g_configs[config], 0);
+      benchGroup(&g_configs[config], 1);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,722 @@
+/*******************************************************************************
+ * @file    hd44780Model.c
+ * @author  Jay Convertino(electrobs@gmail.com)
+ * @date    2024.03.11
+ * @brief   Host side model of the hitachi 44780 LCD controller and AVR ports
+ * @details Instruction set, address counter, display shift and execution times
+ *          follow the HD44780U datasheet (see datasheets/HD44780.pdf).
+ * @version 0.6.0
+ *
+ * @license mit
+ *
+ * Copyright 2024 Johnathan Convertino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "hd44780Model.h"
+
+//execution times at 270 kHz from the datasheet instruction table
+#define EXEC_NS       37000ULL
+#define EXEC_LONG_NS  1520000ULL
+//data writes need tADD on top of the instruction time
+#define EXEC_DATA_NS  41000ULL
+//power on reset keeps the controller busy
+#define POWER_ON_NS   10000000ULL
+//minimum enable high time (PW_EH)
+#define ENA_PW_NS     230
+
+volatile uint8_t hostPortB[3];
+volatile uint8_t hostPortC[3];
+volatile uint8_t hostPortD[3];
+volatile uint8_t hostSREG = (1 << SREG_I);
+
+struct s_hostStats hostStats;
+
+static struct s_hd44780Model *gp_models = NULL;
+static struct s_pcf8574Model *gp_expanders = NULL;
+static struct s_hc595Model *gp_shifters = NULL;
+
+static uint64_t execNs(struct s_hd44780Model *p_model, uint64_t ns);
+static uint8_t pinLevel(struct s_hd44780Model *p_model, uint8_t pin);
+static void drivePins(struct s_hd44780Model *p_model, uint8_t data, uint8_t first, uint8_t count);
+static void modelUpdate(struct s_hd44780Model *p_model);
+static void modelWrite(struct s_hd44780Model *p_model, uint8_t data, uint8_t rs);
+static void modelInstruction(struct s_hd44780Model *p_model, uint8_t data);
+static void modelData(struct s_hd44780Model *p_model, uint8_t data);
+static uint8_t modelReadByte(struct s_hd44780Model *p_model, uint8_t rs);
+static void modelStep(struct s_hd44780Model *p_model, uint8_t increment);
+static void shifterUpdate(struct s_hc595Model *p_shifter);
+
+//put ports, time and statistics back to power on
+void hostReset(void)
+{
+  memset((void *)hostPortB, 0, sizeof(hostPortB));
+  memset((void *)hostPortC, 0, sizeof(hostPortC));
+  memset((void *)hostPortD, 0, sizeof(hostPortD));
+  memset(&hostStats, 0, sizeof(hostStats));
+
+  hostSREG = (1 << SREG_I);
+
+  gp_models = NULL;
+  gp_expanders = NULL;
+  gp_shifters = NULL;
+}
+
+//time only moves here and in port accesses
+void hostDelayNs(uint64_t ns)
+{
+  hostIrqSync();
+
+  hostStats.timeNs += ns;
+}
+
+//SREG restores are plain stores, notice them at the next event. No time passes
+//between the last event and the store so the window closes at the right time.
+void hostIrqSync(void)
+{
+  if(hostStats.irqOff && (hostSREG & (1 << SREG_I)))
+  {
+    uint64_t window = hostStats.timeNs - hostStats.irqOffStartNs;
+
+    hostStats.irqOffNs += window;
+
+    if(window > hostStats.irqOffMaxNs) hostStats.irqOffMaxNs = window;
+
+    hostStats.irqOff = 0;
+  }
+  else if(!hostStats.irqOff && !(hostSREG & (1 << SREG_I)))
+  {
+    hostStats.irqOffStartNs = hostStats.timeNs;
+    hostStats.irqOff = 1;
+  }
+}
+
+void hostCli(void)
+{
+  hostIrqSync();
+
+  hostSREG &= ~(1 << SREG_I);
+
+  hostIrqSync();
+}
+
+void hostSei(void)
+{
+  hostSREG |= (1 << SREG_I);
+
+  hostIrqSync();
+}
+
+void hostPortWrite(volatile uint8_t *p_port, uint8_t value)
+{
+  hostIrqSync();
+
+  hostStats.portWrites++;
+  hostStats.timeNs += HOST_PORT_ACCESS_NS;
+
+  *p_port = value;
+
+  hostPortUpdate();
+}
+
+uint8_t hostPortRead(volatile uint8_t *p_port)
+{
+  hostIrqSync();
+
+  hostStats.portReads++;
+  hostStats.timeNs += HOST_PORT_ACCESS_NS;
+
+  return *p_port;
+}
+
+void hostPortUpdate(void)
+{
+  struct s_hd44780Model *p_model = NULL;
+  struct s_hc595Model *p_shifter = NULL;
+
+  //shift registers first, their outputs may feed a model
+  for(p_shifter = gp_shifters; p_shifter != NULL; p_shifter = p_shifter->p_next)
+  {
+    shifterUpdate(p_shifter);
+  }
+
+  for(p_model = gp_models; p_model != NULL; p_model = p_model->p_next)
+  {
+    modelUpdate(p_model);
+  }
+}
+
+//SPDR write, the byte moves through every register of each chain
+void hostSpiStart(uint8_t data)
+{
+  struct s_hc595Model *p_shifter = NULL;
+  struct s_hc595Model *p_link = NULL;
+  uint8_t carry = 0;
+  uint8_t shifted = 0;
+
+  hostIrqSync();
+
+  hostStats.portWrites++;
+  hostStats.timeNs += HOST_PORT_ACCESS_NS;
+  hostStats.spiBytes++;
+  hostStats.spiDoneNs = hostStats.timeNs + ((SPI_BYTE_CYCLES * 1000000000ULL) / F_CPU);
+
+  for(p_shifter = gp_shifters; p_shifter != NULL; p_shifter = p_shifter->p_next)
+  {
+    carry = data;
+
+    for(p_link = p_shifter; p_link != NULL; p_link = p_link->p_chain)
+    {
+      shifted = p_link->shift;
+      p_link->shift = carry;
+      carry = shifted;
+    }
+  }
+}
+
+//SPIF poll
+void hostSpiWait(void)
+{
+  hostIrqSync();
+
+  if(hostStats.timeNs < hostStats.spiDoneNs) hostStats.timeNs = hostStats.spiDoneNs;
+
+  hostStats.portReads++;
+  hostStats.timeNs += HOST_PORT_ACCESS_NS;
+}
+
+//power on state per datasheet: 8 bit, 1 line, display off, increment
+void hd44780ModelInit(struct s_hd44780Model *p_model, uint32_t fosc)
+{
+  if(p_model == NULL) return;
+
+  memset(p_model, 0, sizeof(*p_model));
+  memset(p_model->ddram, ' ', sizeof(p_model->ddram));
+
+  p_model->fosc = (fosc ? fosc : HD44780_FOSC_HZ);
+  p_model->entryMode = 0x02;
+  p_model->functionSet = 0x10;
+  p_model->busyUntilNs = hostStats.timeNs + POWER_ON_NS;
+  p_model->resetUntilNs = p_model->busyUntilNs;
+}
+
+void hd44780ModelWire(struct s_hd44780Model *p_model, uint8_t pin, volatile uint8_t *p_port, uint8_t bit)
+{
+  if(p_model == NULL) return;
+
+  if(pin >= HD44780_PINS) return;
+
+  p_model->pins[pin].p_port = p_port;
+  p_model->pins[pin].bit = bit;
+  p_model->pins[pin].p_pin = NULL;
+
+  //emulated AVR ports can be read back through PINx
+  if((p_port == &PORTB) || (p_port == &PORTC) || (p_port == &PORTD))
+  {
+    p_model->pins[pin].p_pin = p_port - 2;
+  }
+}
+
+void hd44780ModelWireParallel(struct s_hd44780Model *p_model, volatile uint8_t *p_dataPort, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t rw, uint8_t mode)
+{
+  uint8_t index = 0;
+
+  if(p_model == NULL) return;
+
+  for(index = 0; index < 8; index++)
+  {
+    if(mode)
+    {
+      hd44780ModelWire(p_model, HD44780_D0 + index, p_dataPort, index);
+    }
+    else if(index >= 4)
+    {
+      hd44780ModelWire(p_model, HD44780_D0 + index, p_dataPort, index - 4);
+    }
+  }
+
+  hd44780ModelWire(p_model, HD44780_RS, p_ctrlPort, rs);
+  hd44780ModelWire(p_model, HD44780_E, p_ctrlPort, ena);
+
+  if(rw != 0xFF) hd44780ModelWire(p_model, HD44780_RW, p_ctrlPort, rw);
+}
+
+void hd44780ModelAttach(struct s_hd44780Model *p_model)
+{
+  if(p_model == NULL) return;
+
+  p_model->p_next = gp_models;
+  gp_models = p_model;
+
+  p_model->lastE = pinLevel(p_model, HD44780_E);
+}
+
+//2 line mode has two 40 byte lines at 0x00 and 0x40, 1 line mode one 80 byte line
+uint8_t hd44780ModelCell(struct s_hd44780Model *p_model, uint8_t row, uint8_t col, uint8_t cols)
+{
+  uint8_t pos = 0;
+
+  if(p_model == NULL) return 0;
+
+  pos = col + ((row & 0x02) ? cols : 0);
+
+  if(p_model->functionSet & 0x08)
+  {
+    return p_model->ddram[((row & 0x01) ? 0x40 : 0x00) + ((pos + p_model->shift) % 40)];
+  }
+
+  return p_model->ddram[(pos + p_model->shift) % 80];
+}
+
+void hd44780ModelPrint(struct s_hd44780Model *p_model, FILE *p_file, uint8_t rows, uint8_t cols)
+{
+  uint8_t row = 0;
+  uint8_t col = 0;
+  uint8_t data = 0;
+
+  if(p_model == NULL) return;
+
+  for(row = 0; row < rows; row++)
+  {
+    fputc('|', p_file);
+
+    for(col = 0; col < cols; col++)
+    {
+      data = hd44780ModelCell(p_model, row, col, cols);
+
+      fputc(((data < 0x08) ? '#' : data), p_file);
+    }
+
+    fputs("|\n", p_file);
+  }
+}
+
+void pcf8574ModelInit(struct s_pcf8574Model *p_expander, uint8_t address, uint32_t scl)
+{
+  if(p_expander == NULL) return;
+
+  memset(p_expander, 0, sizeof(*p_expander));
+
+  //quasi bidirectional outputs come up high
+  p_expander->port[2] = 0xFF;
+  p_expander->address = address;
+  p_expander->scl = (scl ? scl : 100000UL);
+}
+
+void pcf8574ModelAttach(struct s_pcf8574Model *p_expander)
+{
+  if(p_expander == NULL) return;
+
+  p_expander->p_next = gp_expanders;
+  gp_expanders = p_expander;
+}
+
+void hd44780ModelWirePcf8574(struct s_hd44780Model *p_model, struct s_pcf8574Model *p_expander)
+{
+  uint8_t index = 0;
+
+  if(p_model == NULL) return;
+
+  if(p_expander == NULL) return;
+
+  for(index = 4; index < 8; index++)
+  {
+    hd44780ModelWire(p_model, HD44780_D0 + index, &p_expander->port[2], index);
+  }
+
+  hd44780ModelWire(p_model, HD44780_RS, &p_expander->port[2], 0);
+  hd44780ModelWire(p_model, HD44780_RW, &p_expander->port[2], 1);
+  hd44780ModelWire(p_model, HD44780_E, &p_expander->port[2], 2);
+}
+
+void hc595ModelInit(struct s_hc595Model *p_shifter, volatile uint8_t *p_rclkPort, uint8_t rclkBit)
+{
+  if(p_shifter == NULL) return;
+
+  memset(p_shifter, 0, sizeof(*p_shifter));
+
+  p_shifter->p_rclkPort = p_rclkPort;
+  p_shifter->rclkBit = rclkBit;
+  p_shifter->lastRclk = (*p_rclkPort >> rclkBit) & 0x01;
+}
+
+void hc595ModelChain(struct s_hc595Model *p_near, struct s_hc595Model *p_far)
+{
+  if(p_near == NULL) return;
+
+  p_near->p_chain = p_far;
+}
+
+void hc595ModelAttach(struct s_hc595Model *p_shifter)
+{
+  if(p_shifter == NULL) return;
+
+  p_shifter->p_next = gp_shifters;
+  gp_shifters = p_shifter;
+}
+
+void hd44780ModelWireHc595(struct s_hd44780Model *p_model, struct s_hc595Model *p_ctrl, struct s_hc595Model *p_data)
+{
+  uint8_t index = 0;
+
+  if(p_model == NULL) return;
+
+  if(p_ctrl == NULL) return;
+
+  for(index = (p_data ? 0 : 4); index < 8; index++)
+  {
+    hd44780ModelWire(p_model, HD44780_D0 + index, (p_data ? &p_data->port[2] : &p_ctrl->port[2]), index);
+  }
+
+  hd44780ModelWire(p_model, HD44780_RS, &p_ctrl->port[2], 0);
+  hd44780ModelWire(p_model, HD44780_RW, &p_ctrl->port[2], 1);
+  hd44780ModelWire(p_model, HD44780_E, &p_ctrl->port[2], 2);
+}
+
+//private, RCLK rising edge copies every shift register of the chain to its outputs
+static void shifterUpdate(struct s_hc595Model *p_shifter)
+{
+  struct s_hc595Model *p_link = NULL;
+  uint8_t rclk = (*(p_shifter->p_rclkPort) >> p_shifter->rclkBit) & 0x01;
+
+  if(rclk == p_shifter->lastRclk) return;
+
+  p_shifter->lastRclk = rclk;
+
+  if(!rclk) return;
+
+  for(p_link = p_shifter; p_link != NULL; p_link = p_link->p_chain)
+  {
+    p_link->port[2] = p_link->shift;
+    p_link->latches++;
+  }
+}
+
+//9 clocks per byte with the ack, about 2 more for START and STOP. Outputs change at the ack of each byte.
+void pcf8574ModelSend(uint8_t address, uint8_t *p_data, uint8_t length)
+{
+  struct s_pcf8574Model *p_expander = NULL;
+  uint64_t byteNs = 0;
+  uint8_t index = 0;
+
+  for(p_expander = gp_expanders; p_expander != NULL; p_expander = p_expander->p_next)
+  {
+    if(p_expander->address == address) break;
+  }
+
+  //nobody acks, the master gives up after the address byte
+  if(p_expander == NULL)
+  {
+    hostDelayNs((11 * 1000000000ULL) / 100000UL);
+    return;
+  }
+
+  byteNs = (9 * 1000000000ULL) / p_expander->scl;
+
+  p_expander->transfers++;
+
+  hostDelayNs(byteNs + ((2 * 1000000000ULL) / p_expander->scl));
+
+  for(index = 0; index < length; index++)
+  {
+    hostDelayNs(byteNs);
+    hostPortWrite(&p_expander->port[2], p_data[index]);
+    p_expander->bytes++;
+  }
+}
+
+//private, execution time scaled from 270 kHz to the model oscillator
+static uint64_t execNs(struct s_hd44780Model *p_model, uint64_t ns)
+{
+  return (ns * HD44780_FOSC_HZ) / p_model->fosc;
+}
+
+//private, level of a wired pin, unwired pins read low
+static uint8_t pinLevel(struct s_hd44780Model *p_model, uint8_t pin)
+{
+  if(p_model->pins[pin].p_port == NULL) return 0;
+
+  return (*(p_model->pins[pin].p_port) >> p_model->pins[pin].bit) & 0x01;
+}
+
+//private, put data bits on the readable data pins starting at D[first]
+static void drivePins(struct s_hd44780Model *p_model, uint8_t data, uint8_t first, uint8_t count)
+{
+  uint8_t index = 0;
+  struct s_hd44780Pin *p_pin = NULL;
+
+  for(index = 0; index < count; index++)
+  {
+    p_pin = &p_model->pins[HD44780_D0 + first + index];
+
+    if(p_pin->p_pin == NULL) continue;
+
+    if((data >> index) & 0x01)
+    {
+      *(p_pin->p_pin) |= (1 << p_pin->bit);
+    }
+    else
+    {
+      *(p_pin->p_pin) &= ~(1 << p_pin->bit);
+    }
+  }
+}
+
+//private, watch E for edges, writes latch on the falling edge, reads drive on the rising edge
+static void modelUpdate(struct s_hd44780Model *p_model)
+{
+  uint8_t ena = pinLevel(p_model, HD44780_E);
+  uint8_t rs = pinLevel(p_model, HD44780_RS);
+  uint8_t rw = pinLevel(p_model, HD44780_RW);
+  uint8_t data = 0;
+  uint8_t index = 0;
+  uint8_t eightBit = (p_model->functionSet & 0x10);
+
+  if(ena == p_model->lastE) return;
+
+  p_model->lastE = ena;
+
+  if(ena)
+  {
+    p_model->eRiseNs = hostStats.timeNs;
+
+    if(!rw) return;
+
+    if(!eightBit && p_model->nibblePhase)
+    {
+      drivePins(p_model, p_model->readLatch, 4, 4);
+      return;
+    }
+
+    p_model->readLatch = modelReadByte(p_model, rs);
+
+    if(eightBit)
+    {
+      drivePins(p_model, p_model->readLatch, 0, 8);
+    }
+    else
+    {
+      drivePins(p_model, p_model->readLatch >> 4, 4, 4);
+    }
+
+    return;
+  }
+
+  p_model->strobes++;
+
+  if((hostStats.timeNs - p_model->eRiseNs) < ENA_PW_NS) p_model->timingViolations++;
+
+  for(index = 0; index < 8; index++)
+  {
+    data |= (pinLevel(p_model, HD44780_D0 + index) << index);
+  }
+
+  //4 bit transfers are two nibbles on D4-D7, top nibble first
+  if(!eightBit)
+  {
+    if(!p_model->nibblePhase)
+    {
+      //the busy flag covers the top nibble of the next write too
+      if(!rw && (hostStats.timeNs < p_model->busyUntilNs)) p_model->busyViolations++;
+
+      p_model->nibble = data & 0xF0;
+      p_model->nibblePhase = 1;
+      return;
+    }
+
+    data = p_model->nibble | (data >> 4);
+    p_model->nibblePhase = 0;
+  }
+
+  if(rw)
+  {
+    //data reads move the address counter once the byte is out
+    if(rs) modelStep(p_model, p_model->entryMode & 0x02);
+    return;
+  }
+
+  modelWrite(p_model, data, rs);
+}
+
+//private, a byte has been latched
+static void modelWrite(struct s_hd44780Model *p_model, uint8_t data, uint8_t rs)
+{
+  if(hostStats.timeNs < p_model->busyUntilNs) p_model->busyViolations++;
+
+  //the internal reset ignores the bus
+  if(hostStats.timeNs < p_model->resetUntilNs) return;
+
+  if(rs)
+  {
+    modelData(p_model, data);
+    p_model->busyUntilNs = hostStats.timeNs + execNs(p_model, EXEC_DATA_NS);
+    return;
+  }
+
+  modelInstruction(p_model, data);
+}
+
+//private, execute an instruction byte
+static void modelInstruction(struct s_hd44780Model *p_model, uint8_t data)
+{
+  uint64_t exec = EXEC_NS;
+
+  p_model->instructions++;
+
+  if(data & 0x80)
+  {
+    p_model->ac = data & 0x7F;
+    p_model->cgramSelected = 0;
+  }
+  else if(data & 0x40)
+  {
+    p_model->ac = data & 0x3F;
+    p_model->cgramSelected = 1;
+  }
+  else if(data & 0x20)
+  {
+    p_model->functionSet = data & 0x1C;
+  }
+  else if(data & 0x10)
+  {
+    if(data & 0x08)
+    {
+      //display shift, the view moves and the address counter stays
+      p_model->shift = (data & 0x04) ? (p_model->shift + 39) % 40 : (p_model->shift + 1) % 40;
+    }
+    else
+    {
+      modelStep(p_model, data & 0x04);
+    }
+  }
+  else if(data & 0x08)
+  {
+    p_model->displayControl = data & 0x07;
+  }
+  else if(data & 0x04)
+  {
+    p_model->entryMode = data & 0x03;
+  }
+  else if(data & 0x02)
+  {
+    p_model->ac = 0;
+    p_model->cgramSelected = 0;
+    p_model->shift = 0;
+    exec = EXEC_LONG_NS;
+  }
+  else if(data & 0x01)
+  {
+    memset(p_model->ddram, ' ', sizeof(p_model->ddram));
+    p_model->ac = 0;
+    p_model->cgramSelected = 0;
+    p_model->shift = 0;
+    p_model->entryMode |= 0x02;
+    exec = EXEC_LONG_NS;
+  }
+
+  p_model->busyUntilNs = hostStats.timeNs + execNs(p_model, exec);
+}
+
+//private, write data at the address counter
+static void modelData(struct s_hd44780Model *p_model, uint8_t data)
+{
+  p_model->dataWrites++;
+
+  if(p_model->cgramSelected)
+  {
+    p_model->cgram[p_model->ac & 0x3F] = data & 0x1F;
+  }
+  else
+  {
+    p_model->ddram[p_model->ac & 0x7F] = data;
+  }
+
+  modelStep(p_model, p_model->entryMode & 0x02);
+
+  //entry mode shift moves the view with the cursor
+  if(!p_model->cgramSelected && (p_model->entryMode & 0x01))
+  {
+    p_model->shift = (p_model->entryMode & 0x02) ? (p_model->shift + 1) % 40 : (p_model->shift + 39) % 40;
+  }
+}
+
+//private, busy flag and address counter, or data at the address counter
+static uint8_t modelReadByte(struct s_hd44780Model *p_model, uint8_t rs)
+{
+  p_model->reads++;
+
+  if(!rs)
+  {
+    return ((hostStats.timeNs < p_model->busyUntilNs) ? 0x80 : 0x00) | (p_model->ac & 0x7F);
+  }
+
+  if(p_model->cgramSelected) return p_model->cgram[p_model->ac & 0x3F];
+
+  return p_model->ddram[p_model->ac & 0x7F];
+}
+
+//private, move the address counter one step, DDRAM lines wrap 0x27 <-> 0x40 and 0x67 <-> 0x00
+static void modelStep(struct s_hd44780Model *p_model, uint8_t increment)
+{
+  if(p_model->cgramSelected)
+  {
+    p_model->ac = (p_model->ac + (increment ? 1 : -1)) & 0x3F;
+    return;
+  }
+
+  if(!(p_model->functionSet & 0x08))
+  {
+    p_model->ac = (increment ? (p_model->ac + 1) % 80 : (p_model->ac + 79) % 80);
+    return;
+  }
+
+  if(increment)
+  {
+    if(p_model->ac == 0x27)
+    {
+      p_model->ac = 0x40;
+    }
+    else if(p_model->ac == 0x67)
+    {
+      p_model->ac = 0x00;
+    }
+    else
+    {
+      p_model->ac++;
+    }
+
+    return;
+  }
+
+  if(p_model->ac == 0x00)
+  {
+    p_model->ac = 0x67;
+  }
+  else if(p_model->ac == 0x40)
+  {
+    p_model->ac = 0x27;
+  }
+  else
+  {
+    p_model->ac--;
+  }
+}
@@ -0,0 +1,591 @@
+/*******************************************************************************
+ * @file    hd44780Model.h
+ * @author  Jay Convertino(electrobs@gmail.com)
+ * @date    2024.03.11
+ * @brief   Host side model of the hitachi 44780 LCD controller and AVR ports
+ * @details Stands in for avr/io.h, avr/interrupt.h and util/delay.h when the
+ *          library is built with HITACHI_LCD_HOST. Time only moves forward in
+ *          delays and port accesses, so runs are exact and repeatable.
+ * @version 0.6.0
+ *
+ * @license mit
+ *
+ * Copyright 2024 Johnathan Convertino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef _HD44780_MODEL_H_
+#define _HD44780_MODEL_H_
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+//emulated I/O ports, laid out PINx, DDRx, PORTx like the AVR I/O space
+extern volatile uint8_t hostPortB[3];
+extern volatile uint8_t hostPortC[3];
+extern volatile uint8_t hostPortD[3];
+
+#define PINB  (hostPortB[0])
+#define DDRB  (hostPortB[1])
+#define PORTB (hostPortB[2])
+#define PINC  (hostPortC[0])
+#define DDRC  (hostPortC[1])
+#define PORTC (hostPortC[2])
+#define PIND  (hostPortD[0])
+#define DDRD  (hostPortD[1])
+#define PORTD (hostPortD[2])
+
+//emulated status register, only the interrupt flag means anything
+extern volatile uint8_t hostSREG;
+
+#define SREG hostSREG
+#define SREG_I 7
+
+#define cli() hostCli()
+#define sei() hostSei()
+
+#define _delay_us(us) hostDelayNs((uint64_t)((us) * 1000.0))
+#define _delay_ms(ms) hostDelayNs((uint64_t)((ms) * 1000000.0))
+//3 and 4 cycle busy loops, a count of 0 runs the full 256 or 65536 loops
+#define _delay_loop_1(n) hostDelayNs((uint64_t)((n) ? (n) : 256) * 3 * 1000000000ULL / F_CPU)
+#define _delay_loop_2(n) hostDelayNs((uint64_t)((n) ? (n) : 65536) * 4 * 1000000000ULL / F_CPU)
+
+//program memory is ordinary memory on the host
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+
+//one port access is an in/out plus the read-modify-write, about 2 cycles
+#define HOST_PORT_ACCESS_NS (2000000000ULL / F_CPU)
+
+//SPI master at F_CPU/2 shifts a byte in 16 cycles
+#define SPI_BYTE_CYCLES 16
+
+//model pin indexes
+#define HD44780_D0   0
+#define HD44780_D1   1
+#define HD44780_D2   2
+#define HD44780_D3   3
+#define HD44780_D4   4
+#define HD44780_D5   5
+#define HD44780_D6   6
+#define HD44780_D7   7
+#define HD44780_RS   8
+#define HD44780_RW   9
+#define HD44780_E    10
+#define HD44780_PINS 11
+
+//oscillator of a stock HD44780 at 5V, execution times scale with it
+#define HD44780_FOSC_HZ 270000UL
+
+/**
+ * @struct s_hd44780Pin
+ * @brief Where a controller pin is wired to
+ */
+struct s_hd44780Pin
+{
+  /**
+   * @var s_hd44780Pin::p_port
+   * output latch driving the pin, NULL if the pin is not wired (reads low).
+   */
+  volatile uint8_t *p_port;
+  /**
+   * @var s_hd44780Pin::p_pin
+   * input register the controller drives on reads, NULL if not readable.
+   */
+  volatile uint8_t *p_pin;
+  /**
+   * @var s_hd44780Pin::bit
+   * bit number on the port
+   */
+  uint8_t bit;
+};
+
+/**
+ * @struct s_hd44780Model
+ * @brief State of one emulated controller
+ */
+struct s_hd44780Model
+{
+  /**
+   * @var s_hd44780Model::pins
+   * wiring of D0-D7, RS, RW and E
+   */
+  struct s_hd44780Pin pins[HD44780_PINS];
+  /**
+   * @var s_hd44780Model::ddram
+   * display data RAM
+   */
+  uint8_t ddram[0x80];
+  /**
+   * @var s_hd44780Model::cgram
+   * character generator RAM, 8 glyphs of 8 rows
+   */
+  uint8_t cgram[64];
+  /**
+   * @var s_hd44780Model::ac
+   * address counter
+   */
+  uint8_t ac;
+  /**
+   * @var s_hd44780Model::cgramSelected
+   * 1 when the address counter points into CGRAM
+   */
+  uint8_t cgramSelected;
+  /**
+   * @var s_hd44780Model::entryMode
+   * last entry mode set
+   */
+  uint8_t entryMode;
+  /**
+   * @var s_hd44780Model::displayControl
+   * last display control
+   */
+  uint8_t displayControl;
+  /**
+   * @var s_hd44780Model::functionSet
+   * last function set, starts in 8 bit mode
+   */
+  uint8_t functionSet;
+  /**
+   * @var s_hd44780Model::shift
+   * display shift, DDRAM column shown in the leftmost position
+   */
+  uint8_t shift;
+  /**
+   * @var s_hd44780Model::nibblePhase
+   * 1 after the first nibble of a 4 bit transfer
+   */
+  uint8_t nibblePhase;
+  /**
+   * @var s_hd44780Model::nibble
+   * first nibble of a 4 bit write
+   */
+  uint8_t nibble;
+  /**
+   * @var s_hd44780Model::readLatch
+   * byte being read out
+   */
+  uint8_t readLatch;
+  /**
+   * @var s_hd44780Model::lastE
+   * level of E at the last port update
+   */
+  uint8_t lastE;
+  /**
+   * @var s_hd44780Model::fosc
+   * oscillator frequency, scales execution times
+   */
+  uint32_t fosc;
+  /**
+   * @var s_hd44780Model::busyUntilNs
+   * host time the current command finishes
+   */
+  uint64_t busyUntilNs;
+  /**
+   * @var s_hd44780Model::resetUntilNs
+   * host time the power on reset finishes, bytes before it are ignored
+   */
+  uint64_t resetUntilNs;
+  /**
+   * @var s_hd44780Model::eRiseNs
+   * host time E went high
+   */
+  uint64_t eRiseNs;
+  /**
+   * @var s_hd44780Model::instructions
+   * instruction bytes executed
+   */
+  uint32_t instructions;
+  /**
+   * @var s_hd44780Model::dataWrites
+   * data bytes written
+   */
+  uint32_t dataWrites;
+  /**
+   * @var s_hd44780Model::reads
+   * bytes read (busy flag or data)
+   */
+  uint32_t reads;
+  /**
+   * @var s_hd44780Model::strobes
+   * falling edges of E
+   */
+  uint32_t strobes;
+  /**
+   * @var s_hd44780Model::busyViolations
+   * bytes, or top nibbles in 4 bit mode, written while the controller was still busy
+   */
+  uint32_t busyViolations;
+  /**
+   * @var s_hd44780Model::timingViolations
+   * enable pulses shorter than the datasheet minimum
+   */
+  uint32_t timingViolations;
+  /**
+   * @var s_hd44780Model::p_next
+   * next attached model
+   */
+  struct s_hd44780Model *p_next;
+};
+
+/**
+ * @struct s_pcf8574Model
+ * @brief I2C port expander of the usual LCD backpack, its outputs are a port
+ *        the HD44780 model can be wired to
+ */
+struct s_pcf8574Model
+{
+  /**
+   * @var s_pcf8574Model::port
+   * outputs laid out like an AVR port (PIN, DDR, PORT), wire to port + 2
+   */
+  volatile uint8_t port[3];
+  /**
+   * @var s_pcf8574Model::address
+   * 7 bit I2C address
+   */
+  uint8_t address;
+  /**
+   * @var s_pcf8574Model::scl
+   * bus clock in Hz, sets how long each byte takes
+   */
+  uint32_t scl;
+  /**
+   * @var s_pcf8574Model::transfers
+   * START to STOP transactions addressed to this expander
+   */
+  uint32_t transfers;
+  /**
+   * @var s_pcf8574Model::bytes
+   * data bytes written to the outputs
+   */
+  uint32_t bytes;
+  /**
+   * @var s_pcf8574Model::p_next
+   * next attached expander
+   */
+  struct s_pcf8574Model *p_next;
+};
+
+/**
+ * @struct s_hc595Model
+ * @brief 74HC595 shift register on the SPI bus, its outputs are a port the
+ *        HD44780 model can be wired to
+ */
+struct s_hc595Model
+{
+  /**
+   * @var s_hc595Model::port
+   * storage register outputs laid out like an AVR port (PIN, DDR, PORT), wire to port + 2
+   */
+  volatile uint8_t port[3];
+  /**
+   * @var s_hc595Model::shift
+   * shift register contents
+   */
+  uint8_t shift;
+  /**
+   * @var s_hc595Model::p_rclkPort
+   * port the RCLK (storage latch) pin is wired to
+   */
+  volatile uint8_t *p_rclkPort;
+  /**
+   * @var s_hc595Model::rclkBit
+   * bit number of RCLK
+   */
+  uint8_t rclkBit;
+  /**
+   * @var s_hc595Model::lastRclk
+   * RCLK level at the last port update
+   */
+  uint8_t lastRclk;
+  /**
+   * @var s_hc595Model::latches
+   * storage register updates
+   */
+  uint32_t latches;
+  /**
+   * @var s_hc595Model::p_chain
+   * register fed from this one's serial output, NULL at the end of the chain
+   */
+  struct s_hc595Model *p_chain;
+  /**
+   * @var s_hc595Model::p_next
+   * next attached chain
+   */
+  struct s_hc595Model *p_next;
+};
+
+/**
+ * @struct s_hostStats
+ * @brief Host time and interrupt bookkeeping
+ */
+struct s_hostStats
+{
+  /**
+   * @var s_hostStats::timeNs
+   * emulated time since hostReset
+   */
+  uint64_t timeNs;
+  /**
+   * @var s_hostStats::irqOffNs
+   * total time spent with interrupts disabled
+   */
+  uint64_t irqOffNs;
+  /**
+   * @var s_hostStats::irqOffMaxNs
+   * longest single window with interrupts disabled
+   */
+  uint64_t irqOffMaxNs;
+  /**
+   * @var s_hostStats::irqOffStartNs
+   * start of the current interrupts disabled window
+   */
+  uint64_t irqOffStartNs;
+  /**
+   * @var s_hostStats::irqOff
+   * 1 while a disabled window is open
+   */
+  uint8_t irqOff;
+  /**
+   * @var s_hostStats::portWrites
+   * port register writes
+   */
+  uint32_t portWrites;
+  /**
+   * @var s_hostStats::portReads
+   * port register reads
+   */
+  uint32_t portReads;
+  /**
+   * @var s_hostStats::spiBytes
+   * bytes shifted out of the SPI
+   */
+  uint32_t spiBytes;
+  /**
+   * @var s_hostStats::spiDoneNs
+   * time the byte in the SPI data register is shifted out
+   */
+  uint64_t spiDoneNs;
+};
+
+extern struct s_hostStats hostStats;
+
+/***************************************************************************//**
+ * @brief   reset ports, time, statistics and detach all models
+ ******************************************************************************/
+void hostReset(void);
+
+/***************************************************************************//**
+ * @brief   advance emulated time
+ *
+ * @param   ns nanoseconds to wait
+ ******************************************************************************/
+void hostDelayNs(uint64_t ns);
+
+/***************************************************************************//**
+ * @brief   close any interrupts disabled window ended by a SREG restore
+ ******************************************************************************/
+void hostIrqSync(void);
+
+/***************************************************************************//**
+ * @brief   emulated cli, opens an interrupts disabled window
+ ******************************************************************************/
+void hostCli(void);
+
+/***************************************************************************//**
+ * @brief   emulated sei, closes the interrupts disabled window
+ ******************************************************************************/
+void hostSei(void);
+
+/***************************************************************************//**
+ * @brief   write a port register and let attached models see the change
+ *
+ * @param   p_port register to write
+ * @param   value value to write
+ ******************************************************************************/
+void hostPortWrite(volatile uint8_t *p_port, uint8_t value);
+
+/***************************************************************************//**
+ * @brief   read a port register
+ *
+ * @param   p_port register to read
+ *
+ * @return  register value
+ ******************************************************************************/
+uint8_t hostPortRead(volatile uint8_t *p_port);
+
+/***************************************************************************//**
+ * @brief   let attached models look at their pins, call after changing a
+ *          register the model is wired to without hostPortWrite.
+ ******************************************************************************/
+void hostPortUpdate(void);
+
+/***************************************************************************//**
+ * @brief   power on a model, display blank and 8 bit interface selected
+ *
+ * @param   p_model model to initialize
+ * @param   fosc oscillator frequency, HD44780_FOSC_HZ for a stock part
+ ******************************************************************************/
+void hd44780ModelInit(struct s_hd44780Model *p_model, uint32_t fosc);
+
+/***************************************************************************//**
+ * @brief   wire one controller pin to a port bit
+ *
+ * @param   p_model model to wire
+ * @param   pin HD44780_D0 to HD44780_E
+ * @param   p_port output latch, a PORTx register is readable through PINx
+ * @param   bit bit number on the port
+ ******************************************************************************/
+void hd44780ModelWire(struct s_hd44780Model *p_model, uint8_t pin, volatile uint8_t *p_port, uint8_t bit);
+
+/***************************************************************************//**
+ * @brief   wire the model the way initLCD_custom/initLCD_customRW drive it
+ *
+ * @param   p_model model to wire
+ * @param   p_dataPort data port, D4-D7 on bits 0-3 in 4 bit mode
+ * @param   p_ctrlPort control port
+ * @param   rs pin for register select
+ * @param   ena pin for enable
+ * @param   rw pin for read/write, 0xFF if tied low
+ * @param   mode 0 for 4 bit mode, anything else is 8 bit.
+ ******************************************************************************/
+void hd44780ModelWireParallel(struct s_hd44780Model *p_model, volatile uint8_t *p_dataPort, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t rw, uint8_t mode);
+
+/***************************************************************************//**
+ * @brief   attach a model so it follows port writes
+ *
+ * @param   p_model model to attach
+ ******************************************************************************/
+void hd44780ModelAttach(struct s_hd44780Model *p_model);
+
+/***************************************************************************//**
+ * @brief   character shown at a screen position, with display shift applied
+ *
+ * @param   p_model model to read
+ * @param   row screen row, rows 2/3 of a 4 line screen continue lines 0/1
+ * @param   col screen column
+ * @param   cols number of columns of the screen
+ *
+ * @return  DDRAM byte shown at that position
+ ******************************************************************************/
+uint8_t hd44780ModelCell(struct s_hd44780Model *p_model, uint8_t row, uint8_t col, uint8_t cols);
+
+/***************************************************************************//**
+ * @brief   print the visible screen, custom characters show as '#'
+ *
+ * @param   p_model model to print
+ * @param   p_file stream to print to
+ * @param   rows number of rows of the screen
+ * @param   cols number of columns of the screen
+ ******************************************************************************/
+void hd44780ModelPrint(struct s_hd44780Model *p_model, FILE *p_file, uint8_t rows, uint8_t cols);
+
+/***************************************************************************//**
+ * @brief   power on an expander, outputs high
+ *
+ * @param   p_expander expander to initialize
+ * @param   address 7 bit I2C address
+ * @param   scl bus clock in Hz
+ ******************************************************************************/
+void pcf8574ModelInit(struct s_pcf8574Model *p_expander, uint8_t address, uint32_t scl);
+
+/***************************************************************************//**
+ * @brief   attach an expander so pcf8574ModelSend can reach it
+ *
+ * @param   p_expander expander to attach
+ ******************************************************************************/
+void pcf8574ModelAttach(struct s_pcf8574Model *p_expander);
+
+/***************************************************************************//**
+ * @brief   wire a model to the expander the way the common backpack does,
+ *          P0 RS, P1 RW, P2 E, P3 backlight, P4-P7 D4-D7
+ *
+ * @param   p_model model to wire
+ * @param   p_expander expander it hangs off
+ ******************************************************************************/
+void hd44780ModelWirePcf8574(struct s_hd44780Model *p_model, struct s_pcf8574Model *p_expander);
+
+/***************************************************************************//**
+ * @brief   I2C write transaction, takes the bus time for START, address,
+ *          every byte and STOP. Matches the twi_callback of the library.
+ *
+ * @param   address 7 bit I2C address
+ * @param   p_data bytes to write
+ * @param   length number of bytes
+ ******************************************************************************/
+void pcf8574ModelSend(uint8_t address, uint8_t *p_data, uint8_t length);
+
+/***************************************************************************//**
+ * @brief   start shifting a byte out of the emulated SPI at F_CPU/2, it
+ *          reaches every attached 74HC595 chain
+ *
+ * @param   data byte to shift
+ ******************************************************************************/
+void hostSpiStart(uint8_t data);
+
+/***************************************************************************//**
+ * @brief   wait until the SPI byte is shifted out
+ ******************************************************************************/
+void hostSpiWait(void);
+
+/***************************************************************************//**
+ * @brief   power on a shift register, outputs low
+ *
+ * @param   p_shifter register to initialize
+ * @param   p_rclkPort port RCLK is wired to
+ * @param   rclkBit bit number of RCLK
+ ******************************************************************************/
+void hc595ModelInit(struct s_hc595Model *p_shifter, volatile uint8_t *p_rclkPort, uint8_t rclkBit);
+
+/***************************************************************************//**
+ * @brief   feed p_far from the serial output of p_near, they share RCLK
+ *
+ * @param   p_near register next to the SPI
+ * @param   p_far register after it
+ ******************************************************************************/
+void hc595ModelChain(struct s_hc595Model *p_near, struct s_hc595Model *p_far);
+
+/***************************************************************************//**
+ * @brief   attach the first register of a chain to the SPI
+ *
+ * @param   p_shifter register next to the SPI
+ ******************************************************************************/
+void hc595ModelAttach(struct s_hc595Model *p_shifter);
+
+/***************************************************************************//**
+ * @brief   wire a model the way initLCD_spi drives it. The control register
+ *          has Q0 RS, Q1 RW, Q2 E, Q3 backlight and D4-D7 on Q4-Q7 in 4 bit
+ *          mode, in 8 bit mode D0-D7 are on the second register.
+ *
+ * @param   p_model model to wire
+ * @param   p_ctrl register next to the SPI
+ * @param   p_data register with D0-D7, NULL for 4 bit mode
+ ******************************************************************************/
+void hd44780ModelWireHc595(struct s_hd44780Model *p_model, struct s_hc595Model *p_ctrl, struct s_hc595Model *p_data);
+
+#endif /* _HD44780_MODEL_H_ */
@@ -31,464 +31,3646 @@
 * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 * IN THE SOFTWARE.
 ******************************************************************************/
+#ifdef HITACHI_LCD_HOST
+//fopencookie backs the stream on the host
+#define _GNU_SOURCE
+#endif
+
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <util/delay.h>
-#include <avr/common.h>
+#include <string.h>
 
 #include "commonDefines.h"
 #include "hitachiLcd.h"
+#include "hitachiLcdPort.h"
+
+#ifdef HITACHI_LCD_STATIC
+#include "hitachiLcdConfig.h"
+#endif
 
 void write_4bit(void *p_lcd, uint8_t data, int regSel);
 void write_8bit(void *p_lcd, uint8_t data, int regSel);
 void enaPulse(struct s_lcd *p_lcd);
+void enaStrobe(struct s_lcd *p_lcd);
+void enaLatch(struct s_lcd *p_lcd);
+uint8_t readByte(struct s_lcd *p_lcd, int regSel);
+void waitReady(struct s_lcd *p_lcd, int regSel);
+void setRegSel(struct s_lcd *p_lcd, int regSel);
+void putNibble(struct s_lcd *p_lcd, uint8_t nibble);
+void write_4bit_map(void *p_lcd, uint8_t data, int regSel);
+void write_8bit_map(void *p_lcd, uint8_t data, int regSel);
+void putMap(struct s_lcd *p_lcd, uint8_t lines);
+uint8_t readMap(struct s_lcd *p_lcd);
+void startLCD(struct s_lcd *p_temp, uint8_t mode);
+void initNone(struct s_lcd *p_temp, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+void write_none(void *p_lcd, uint8_t data, int regSel);
+void write_twi(void *p_lcd, uint8_t data, int regSel);
+void twiNibble(struct s_lcd *p_lcd, uint8_t bits);
+void batchPut(struct s_lcd *p_lcd, uint8_t bits);
+void twiSettle(struct s_lcd *p_lcd);
+void syncLCD(struct s_lcd *p_lcd);
+void putBacklight(struct s_lcd *p_lcd);
+void write_spi(void *p_lcd, uint8_t data, int regSel);
+void spiUpdate(struct s_lcd *p_lcd, uint8_t lines, uint8_t bits);
+void spiRclk(struct s_lcd *p_lcd);
+void spiPulse(struct s_lcd *p_lcd, uint8_t lines, uint8_t bits);
+void waitExec(struct s_lcd *p_lcd);
+void waitLong(struct s_lcd *p_lcd);
+
+//one SPI byte at F_CPU/2 is 16 cycles, 4 loops of _delay_loop_2
+#define SPI_BYTE_LOOPS 4
+//busy poll in 8 bit mode, 1us enable pulse, about 1us of port accesses and the 1us wait, 4 bit mode adds a nibble and the gap before it
+#define BUSY_POLL_US 3
+//mapped lines turn and read every port and line on their own, another 2us of port accesses a poll
+#define BUSY_POLL_MAP_US 2
+void write_queue(void *p_lcd, uint8_t data, int regSel);
+uint16_t queueStep(struct s_lcd *p_lcd);
+void lcdWrite(struct s_lcd *p_lcd, uint8_t data, int regSel);
+void trackAddr(struct s_lcd *p_lcd, uint8_t data, int regSel);
+uint8_t parallelBus(struct s_lcd *p_lcd);
+void strobeByte(struct s_lcd *p_lcd, uint8_t data, int regSel);
+void groupFlush(struct s_lcd **pp_lcd, uint8_t count);
+uint8_t groupStep(struct s_lcd *p_lcd, uint16_t *p_index);
+void gotoAddr(struct s_lcd *p_lcd, uint8_t addr);
+uint8_t nextAddr(struct s_lcd *p_lcd, uint8_t addr, uint8_t increment);
+void putNumber(struct s_lcd *p_lcd, char sign, uint32_t number, uint8_t base, uint8_t precision, uint32_t frac, uint8_t width, uint8_t flags);
+uint8_t countDigits(uint32_t number, uint8_t base);
+void putDigits(struct s_lcd *p_lcd, uint32_t number, uint8_t base, uint8_t count, uint8_t flags);
+uint8_t cellAddr(struct s_lcd *p_lcd, uint8_t row, uint8_t col);
+void putChar(struct s_lcd *p_lcd, uint8_t data);
+uint8_t wrapTarget(struct s_lcd *p_lcd, uint8_t addr);
+const struct s_lcdGeometry *defaultGeometry(uint8_t screenSize);
+uint16_t loops2(uint16_t us);
+uint8_t warmStart(struct s_lcd *p_temp, uint8_t mode);
+uint8_t addrRow(struct s_lcd *p_lcd, uint8_t addr);
+uint8_t viewStep(uint8_t shift, uint8_t left);
+uint8_t plainEntry(struct s_lcd *p_lcd);
+void restoreEntry(struct s_lcd *p_lcd, uint8_t entryModeSet);
+uint8_t marqueeChar(struct s_lcdMarquee *p_marquee, uint16_t index);
+void marqueeCell(struct s_lcd *p_lcd, struct s_lcdMarquee *p_marquee, uint8_t offset);
+void widgetCell(struct s_lcd *p_lcd, uint8_t row, uint8_t col, uint8_t data);
+void windowLine(struct s_lcd *p_lcd, struct s_lcdWindow *p_window);
+uint8_t barPixels(uint8_t level, uint8_t index, uint8_t unit);
+const uint8_t *barGlyph(uint8_t direction, uint8_t pixels);
+uint8_t barChar(struct s_lcd *p_lcd, struct s_lcdBar *p_bar, uint8_t pixels);
+uint8_t bigCode(const struct s_lcdBigFont *p_font, uint8_t digit, uint8_t cell);
+uint8_t bigGlyphs(const struct s_lcdBigFont *p_font, uint8_t digit);
+uint8_t bigRefresh(struct s_lcd *p_lcd, struct s_lcdBig *p_big);
+void bigDigit(struct s_lcd *p_lcd, struct s_lcdBig *p_big, uint8_t index, uint8_t digit, uint8_t moved);
+uint16_t scrubRun(struct s_lcd *p_lcd, uint16_t budget, uint8_t *p_repairs);
+uint16_t scrubReset(struct s_lcd *p_lcd, uint16_t budget);
+uint8_t scrubCmd(struct s_lcd *p_lcd, uint16_t index, uint16_t cells);
+void scrubLost(struct s_lcd *p_lcd);
+void resetNibble(struct s_lcd *p_lcd, uint8_t value);
+void putStream(struct s_lcd *p_lcd, char data);
+#ifdef HITACHI_LCD_HOST
+ssize_t streamWrite(void *p_cookie, const char *p_data, size_t size);
+#else
+int streamPut(char data, FILE *p_stream);
+#endif
+
+//wrapAddr when no wrap is owed, above any DDRAM address
+#define NO_WRAP 0xFF
+
+//big font cells that aren't glyphs, blank and the full block of the character ROM
+#define BIG_BLANK ' '
+#define BIG_FULL  0xFF
+//s_lcdBig::shown of a blank digit
+#define BIG_NONE  10
+//no bar cell to rewrite
+#define BAR_NONE  0xFF
+
+//s_lcd::scrubPhase, checking, the three 0x3 nibbles of the reset sequence, setup and the wait for home
+#define SCRUB_CHECK 0
+#define SCRUB_RESET 1
+#define SCRUB_SETUP 4
+#define SCRUB_HOME  5
+//scrub cost of a read or of the strobe around a command, readByte waits 1us per enable pulse
+#define SCRUB_IO_US 4
+
+#ifdef HITACHI_LCD_STATIC
+void write_static(void *p_lcd, uint8_t data, int regSel);
+void staticRegSel(int regSel);
+void staticNibble(uint8_t nibble);
+void staticStrobe(struct s_lcd *p_lcd);
+#endif
+
+#ifdef HITACHI_LCD_STATS
+void statDelay(struct s_lcd *p_lcd, uint16_t us);
+
+//counters, compiled out unless HITACHI_LCD_STATS is defined
+#define STAT_RESET(p)        memset(&(p)->stats, 0, sizeof((p)->stats))
+#define STAT_CALL(p, api)    ((p)->stats.calls[(api)]++)
+#define STAT_BYTE(p, regSel) do { if((regSel) & DATA_REG) (p)->stats.dataBytes++; else (p)->stats.insBytes++; } while(0)
+#define STAT_READ(p)         ((p)->stats.reads++)
+#define STAT_STROBE(p)       ((p)->stats.strobes++)
+#define STAT_DELAY(p, us)    statDelay((p), (us))
+
+//waited with interrupts off since they were last on, one window for all displays
+static uint16_t g_irqOffUs = 0;
+#else
+#define STAT_RESET(p)        do {} while(0)
+#define STAT_CALL(p, api)    do {} while(0)
+#define STAT_BYTE(p, regSel) do {} while(0)
+#define STAT_READ(p)         do {} while(0)
+#define STAT_STROBE(p)       do {} while(0)
+#define STAT_DELAY(p, us)    do {} while(0)
+#endif
+
+//powers of 10 for the number formatters
+static const uint32_t g_pow10[10] PROGMEM = {1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL};
+
+//screen layouts, 4 line screens continue DDRAM lines 0x00 and 0x40 after the first cols
+const struct s_lcdGeometry g_lcdGeometry16x1 PROGMEM = {1, 16, 8, {0x00, 0x00, 0x00, 0x00}};
+const struct s_lcdGeometry g_lcdGeometry16x2 PROGMEM = {2, 16, 0, {0x00, 0x40, 0x00, 0x40}};
+const struct s_lcdGeometry g_lcdGeometry20x2 PROGMEM = {2, 20, 0, {0x00, 0x40, 0x00, 0x40}};
+const struct s_lcdGeometry g_lcdGeometry40x2 PROGMEM = {2, 40, 0, {0x00, 0x40, 0x00, 0x40}};
+const struct s_lcdGeometry g_lcdGeometry16x4 PROGMEM = {4, 16, 0, {0x00, 0x40, 0x10, 0x50}};
+const struct s_lcdGeometry g_lcdGeometry20x4 PROGMEM = {4, 20, 0, {0x00, 0x40, 0x14, 0x54}};
+
+//controller timings, 5V HD44780 allowing for its oscillator tolerance, trimmed clones, 3V modules
+const struct s_lcdTiming g_lcdTimingHD44780 PROGMEM = {50, 2000, 250};
+const struct s_lcdTiming g_lcdTimingST7066 PROGMEM = {40, 1600, 250};
+const struct s_lcdTiming g_lcdTiming3V PROGMEM = {80, 3000, 500};
+
+//bar graph partial cells, 1 to 4 columns lit from the left and 1 to 7 rows lit from the bottom
+static const uint8_t g_barAcross[4][8] PROGMEM =
+{
+  {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10},
+  {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+  {0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C},
+  {0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E}
+};
+static const uint8_t g_barUp[7][8] PROGMEM =
+{
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F},
+  {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+  {0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F},
+  {0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+  {0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+  {0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F}
+};
+
+//seven segment digits, 2 pixel strokes on the cell edges, left/right strokes with top/bottom bars
+const struct s_lcdBigFont g_lcdBigFont2x2 PROGMEM =
+{
+  2, 2,
+  {
+    {0x1F, 0x1F, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+    {0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},
+    {0x1F, 0x1F, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03},
+    {0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x03},
+    {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1F, 0x1F},
+    {0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F},
+    {0x03, 0x03, 0x03, 0x03, 0x03, 0x03, 0x1F, 0x1F}
+  },
+  {
+    {0, 3, 5, 7},
+    {BIG_BLANK, 4, BIG_BLANK, 4},
+    {1, 3, BIG_FULL, 6},
+    {1, 3, 6, BIG_FULL},
+    {2, 4, 1, 3},
+    {0, 1, 6, BIG_FULL},
+    {0, 1, BIG_FULL, BIG_FULL},
+    {1, 3, BIG_BLANK, 4},
+    {0, 3, BIG_FULL, BIG_FULL},
+    {0, 3, 6, BIG_FULL}
+  }
+};
+
+//3x6 pixel digits, each cell is an upper and a lower half pixel
+const struct s_lcdBigFont g_lcdBigFont3x3 PROGMEM =
+{
+  3, 3,
+  {
+    {0x1F, 0x1F, 0x1F, 0x1F, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F}
+  },
+  {
+    {BIG_FULL, 0, BIG_FULL, BIG_FULL, BIG_BLANK, BIG_FULL, BIG_FULL, 1, BIG_FULL},
+    {1, BIG_FULL, BIG_BLANK, BIG_BLANK, BIG_FULL, BIG_BLANK, 1, BIG_FULL, 1},
+    {0, 0, BIG_FULL, BIG_FULL, 0, 0, BIG_FULL, 1, 1},
+    {0, 0, BIG_FULL, 0, 0, BIG_FULL, 1, 1, BIG_FULL},
+    {BIG_FULL, BIG_BLANK, BIG_FULL, 0, 0, BIG_FULL, BIG_BLANK, BIG_BLANK, BIG_FULL},
+    {BIG_FULL, 0, 0, 0, 0, BIG_FULL, 1, 1, BIG_FULL},
+    {BIG_FULL, 0, 0, BIG_FULL, 0, BIG_FULL, BIG_FULL, 1, BIG_FULL},
+    {0, 0, BIG_FULL, BIG_BLANK, BIG_BLANK, BIG_FULL, BIG_BLANK, BIG_BLANK, BIG_FULL},
+    {BIG_FULL, 0, BIG_FULL, BIG_FULL, 0, BIG_FULL, BIG_FULL, 1, BIG_FULL},
+    {BIG_FULL, 0, BIG_FULL, 0, 0, BIG_FULL, 1, 1, BIG_FULL}
+  }
+};
+
+//how inits start the controller, see setInitModeLCD
+static uint8_t g_initMode = LCD_INIT_COLD;
+
+//pick cold, warm or probed start for the inits that follow
+void setInitModeLCD(uint8_t mode)
+{
+  g_initMode = mode;
+}
 
 //setup LCD screen for 4 wire mode Write Only
 void initLCD(struct s_lcd *p_temp, volatile uint8_t *p_dataPort,  uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base)
 {
   uint8_t tmpSREG = 0;
-  tmpSREG = SREG;
-  cli();
+  LCD_IRQ_SAVE(tmpSREG);
 
   if(p_temp == NULL) return;
 
   p_temp->write = write_4bit;
+  STAT_RESET(p_temp);
+  STAT_CALL(p_temp, LCD_STAT_INIT);
+  invalidateGlyphsLCD(p_temp);
+  p_temp->addrValid = 0;
+  p_temp->p_queue = NULL;
+  p_temp->p_shadow = NULL;
+  p_temp->p_dirty = NULL;
+  p_temp->p_map = NULL;
+  p_temp->twiSend = NULL;
+  p_temp->p_batch = NULL;
+  p_temp->batchLen = 0;
+  p_temp->latch = 0;
 
   p_temp->screenSize = screenSize;
+  setGeometryLCD(p_temp, defaultGeometry(screenSize));
+  setTimingLCD(p_temp, &g_lcdTimingHD44780);
   p_temp->width = width;
   p_temp->precision = precision;
   p_temp->base = base;
   p_temp->p_dataPort = p_dataPort;
   p_temp->rs = RS;
   p_temp->ena = ENABLE;
+  p_temp->rw = 0;
+  p_temp->busyCheck = 0;
+  p_temp->lastExec = INS_REG;
   p_temp->p_ctrlPort = p_dataPort;
-  *(p_temp->p_dataPort - 1) |= 0x3F;
+  LCD_PORT_OR(p_temp->p_dataPort - 1, 0x3F);
   // *(p_temp->p_ctrlPort - 1) |= 0x30;
   //setup as defined in Hitachi Datasheet page 46, delays and all
   //set port bits low
-  *(p_temp->p_dataPort) &= ~MASK_8BIT_FF;
+  LCD_PORT_AND(p_temp->p_dataPort, ~MASK_8BIT_FF);
   //set RS to instruction mode
-  *(p_temp->p_ctrlPort) &= ~(p_temp->rs);
-  _delay_ms(50);
+  LCD_PORT_AND(p_temp->p_ctrlPort, ~(p_temp->rs));
+  p_temp->warm = warmStart(p_temp, 0);
+  if(!p_temp->warm) _delay_ms(50);
   //set port values
-  *(p_temp->p_dataPort) |= 0x03;
+  LCD_PORT_OR(p_temp->p_dataPort, 0x03);
   //latch values
   enaPulse(p_temp);
-  _delay_ms(5);
+  if(!p_temp->warm) _delay_ms(5);
   //latch values
   enaPulse(p_temp);
-  _delay_us(200);
+  if(!p_temp->warm) _delay_us(200);
   //latch values
   enaPulse(p_temp);
   //setup for 4 bit mode
-  *(p_temp->p_dataPort) |= 0x02;
-  *(p_temp->p_dataPort) &= ((MASK_8BIT_FF << 4) | 0x02);
+  LCD_PORT_OR(p_temp->p_dataPort, 0x02);
+  LCD_PORT_AND(p_temp->p_dataPort, ((MASK_8BIT_FF << 4) | 0x02));
   enaPulse(p_temp);
-  //function set again, this time once and for all
-  p_temp->functionSet = (LCD_FUNCTIONSET | LCD_2LINE | LCD_5x8DOTS | LCD_4BITMODE);
-  p_temp->write(p_temp, p_temp->functionSet, INS_REG);
-  //display control, enable display and setup cursor and blink
-  p_temp->displaySetting = (LCD_DISPLAYCONTROL | LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF);
-  p_temp->write(p_temp, p_temp->displaySetting, INS_REG);
-  //clear display and set cursor to home
-  clearLCD(p_temp);
-  //setup LCD entry mode
-  p_temp->entryModeSet = (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT);
-  p_temp->write(p_temp, p_temp->entryModeSet, INS_REG);
 
-  SREG = tmpSREG;
+  startLCD(p_temp, 0);
+
+  LCD_IRQ_RESTORE(tmpSREG);
 }
 
 void initLCD_custom(struct s_lcd *p_temp, volatile uint8_t *p_dataPort, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base)
+{
+  initLCD_customRW(p_temp, p_dataPort, p_ctrlPort, rs, ena, LCD_NO_RW, mode, screenSize, width, precision, base);
+}
+
+void initLCD_customRW(struct s_lcd *p_temp, volatile uint8_t *p_dataPort, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t rw, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base)
 {
   uint8_t tmpSREG = 0;
 
-  tmpSREG = SREG;
-  cli();
+  LCD_IRQ_SAVE(tmpSREG);
 
   if(p_temp == NULL) return;
 
   p_temp->write = (mode ? write_8bit : write_4bit);
+  STAT_RESET(p_temp);
+  STAT_CALL(p_temp, LCD_STAT_INIT);
+  invalidateGlyphsLCD(p_temp);
+  p_temp->addrValid = 0;
+  p_temp->p_queue = NULL;
+  p_temp->p_shadow = NULL;
+  p_temp->p_dirty = NULL;
+  p_temp->p_map = NULL;
+  p_temp->twiSend = NULL;
+  p_temp->p_batch = NULL;
+  p_temp->batchLen = 0;
+  p_temp->latch = 0;
 
   p_temp->screenSize = screenSize;
+  setGeometryLCD(p_temp, defaultGeometry(screenSize));
+  setTimingLCD(p_temp, &g_lcdTimingHD44780);
   p_temp->width = width;
   p_temp->precision = precision;
   p_temp->base = base;
   p_temp->p_dataPort = p_dataPort;
   p_temp->rs = (1 << rs);
   p_temp->ena = (1 << ena);
+  p_temp->rw = (rw == LCD_NO_RW ? 0 : (1 << rw));
+  p_temp->busyCheck = 0;
+  p_temp->lastExec = INS_REG;
   p_temp->p_ctrlPort = p_ctrlPort;
   //set output ports for data port
-  *(p_temp->p_dataPort - 1) |= (mode ? ~0 : ~(~0 << 4));
-  //setup control port
-  *(p_temp->p_ctrlPort -1) |= p_temp->rs | p_temp->ena;
+  LCD_PORT_OR(p_temp->p_dataPort - 1, (mode ? ~0 : ~(~0 << 4)));
+  //setup control port, R/W low means write
+  LCD_PORT_OR(p_temp->p_ctrlPort -1, p_temp->rs | p_temp->ena | p_temp->rw);
+  LCD_PORT_AND(p_temp->p_ctrlPort, ~(p_temp->rw));
   //setup as defined in Hitachi Datasheet page 45/46, delays and all
   //set port bits low
-  *(p_temp->p_dataPort) &= ~MASK_8BIT_FF;
+  LCD_PORT_AND(p_temp->p_dataPort, ~MASK_8BIT_FF);
   //set RS to instruction mode
-  *(p_temp->p_ctrlPort) &= ~(p_temp->rs);
-  _delay_ms(50);
+  LCD_PORT_AND(p_temp->p_ctrlPort, ~(p_temp->rs));
+  p_temp->warm = warmStart(p_temp, mode);
+  if(!p_temp->warm) _delay_ms(50);
   //set port values
-  *(p_temp->p_dataPort) |= (mode ? 0x30 : 0x03);
+  LCD_PORT_OR(p_temp->p_dataPort, (mode ? 0x30 : 0x03));
   //latch values
   enaPulse(p_temp);
-  _delay_ms(5);
+  if(!p_temp->warm) _delay_ms(5);
   //latch values
   enaPulse(p_temp);
-  _delay_us(150);
+  if(!p_temp->warm) _delay_us(150);
   //latch values
   enaPulse(p_temp);
   //setup
-  *(p_temp->p_dataPort) |= (mode ? 0x30 : 0x02);
-  *(p_temp->p_dataPort) &= (mode ? 0x30 : ((MASK_8BIT_FF << 4) | 0x02));
+  LCD_PORT_OR(p_temp->p_dataPort, (mode ? 0x30 : 0x02));
+  LCD_PORT_AND(p_temp->p_dataPort, (mode ? 0x30 : ((MASK_8BIT_FF << 4) | 0x02)));
   enaPulse(p_temp);
 
-  //function set again, this is once and for all
-  p_temp->functionSet = (LCD_FUNCTIONSET | LCD_2LINE | LCD_5x8DOTS | (mode ? LCD_8BITMODE : LCD_4BITMODE));
-  p_temp->write(p_temp, p_temp->functionSet, INS_REG);
-  //display control, enable display and setup cursor and blink
-  p_temp->displaySetting = (LCD_DISPLAYCONTROL | LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF);
-  p_temp->write(p_temp, p_temp->displaySetting, INS_REG);
-  //clear display and set cursor to home
-  clearLCD(p_temp);
-  //setup LCD entry mode
-  p_temp->entryModeSet = (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT);
-  p_temp->write(p_temp, p_temp->entryModeSet, INS_REG);
+  startLCD(p_temp, mode);
 
-  SREG = tmpSREG;
+  LCD_IRQ_RESTORE(tmpSREG);
 }
 
-//print string array to display
-void printLCD(struct s_lcd *p_lcd, char *message)
+//setup LCD screen with data lines spread over up to two ports
+void initLCD_map(struct s_lcd *p_temp, struct s_lcdMap *p_map, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t rw, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base)
 {
   uint8_t tmpSREG = 0;
+  uint8_t line = 0;
+  uint8_t index = 0;
+  uint8_t value = 0;
 
-  if(p_lcd == NULL) return;
+  if(p_temp == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  if(p_map == NULL)
+  {
+    initNone(p_temp, screenSize, width, precision, base);
+    return;
+  }
 
-  //as long as pointer isn't pointing to null
-  while(*message != '\0')
+  memset((void *)p_map->p_port, 0, sizeof(p_map->p_port));
+  memset(p_map->mask, 0, sizeof(p_map->mask));
+  memset(p_map->lut, 0, sizeof(p_map->lut));
+  p_map->ports = 0;
+
+  //find the ports and build the tables, 4 bit mode only has D4 to D7
+  for(line = (mode ? 0 : 4); line < 8; line++)
   {
-    //write current character from string
-    p_lcd->write(p_lcd, (uint8_t)*message, DATA_REG);
-    message++;
+    for(index = 0; index < p_map->ports; index++)
+    {
+      if(p_map->p_port[index] == p_map->p_data[line]) break;
+    }
 
+    if(index == p_map->ports)
+    {
+      //too many ports, the handle stays safe to call but drives nothing
+      if(p_map->ports == LCD_MAP_PORTS)
+      {
+        initNone(p_temp, screenSize, width, precision, base);
+        return;
+      }
+
+      p_map->p_port[p_map->ports++] = p_map->p_data[line];
+    }
+
+    p_map->mask[index] |= (1 << p_map->dataBit[line]);
+
+    for(value = 0; value < 16; value++)
+    {
+      if(value & (1 << (line & 0x03))) p_map->lut[index][line >> 2][value] |= (1 << p_map->dataBit[line]);
+    }
   }
-  SREG = tmpSREG;
-}
 
-void printSpecialLCD(struct s_lcd *p_lcd, uint8_t message)
-{
-  uint8_t tmpSREG = 0;
+  LCD_IRQ_SAVE(tmpSREG);
 
-  if(p_lcd == NULL) return;
+  p_temp->write = (mode ? write_8bit_map : write_4bit_map);
+  STAT_RESET(p_temp);
+  STAT_CALL(p_temp, LCD_STAT_INIT);
+  invalidateGlyphsLCD(p_temp);
+  p_temp->addrValid = 0;
+  p_temp->p_queue = NULL;
+  p_temp->p_shadow = NULL;
+  p_temp->p_dirty = NULL;
+  p_temp->p_map = p_map;
+  p_temp->twiSend = NULL;
+  p_temp->p_batch = NULL;
+  p_temp->batchLen = 0;
+  p_temp->latch = 0;
 
-  tmpSREG = SREG;
-  cli();
+  p_temp->screenSize = screenSize;
+  setGeometryLCD(p_temp, defaultGeometry(screenSize));
+  setTimingLCD(p_temp, &g_lcdTimingHD44780);
+  p_temp->width = width;
+  p_temp->precision = precision;
+  p_temp->base = base;
+  p_temp->p_dataPort = p_map->p_port[0];
+  p_temp->rs = (1 << rs);
+  p_temp->ena = (1 << ena);
+  p_temp->rw = (rw == LCD_NO_RW ? 0 : (1 << rw));
+  p_temp->busyCheck = 0;
+  p_temp->lastExec = INS_REG;
+  p_temp->p_ctrlPort = p_ctrlPort;
+  //set output ports for the data lines
+  for(index = 0; index < p_map->ports; index++)
+  {
+    LCD_PORT_OR(p_map->p_port[index] - 1, p_map->mask[index]);
+  }
+  //setup control port, R/W low means write
+  LCD_PORT_OR(p_temp->p_ctrlPort -1, p_temp->rs | p_temp->ena | p_temp->rw);
+  LCD_PORT_AND(p_temp->p_ctrlPort, ~(p_temp->rw));
+  //setup as defined in Hitachi Datasheet page 45/46, delays and all
+  //set data lines low
+  putMap(p_temp, 0x00);
+  //set RS to instruction mode
+  LCD_PORT_AND(p_temp->p_ctrlPort, ~(p_temp->rs));
+  p_temp->warm = warmStart(p_temp, mode);
+  if(!p_temp->warm) _delay_ms(50);
+  //0x3 on D7 to D4 is the 8 bit function set in both modes
+  putMap(p_temp, 0x30);
+  //latch values
+  enaPulse(p_temp);
+  if(!p_temp->warm) _delay_ms(5);
+  //latch values
+  enaPulse(p_temp);
+  if(!p_temp->warm) _delay_us(150);
+  //latch values
+  enaPulse(p_temp);
+  //setup
+  putMap(p_temp, (mode ? 0x30 : 0x20));
+  enaPulse(p_temp);
 
-  //write current character
-  p_lcd->write(p_lcd, message, DATA_REG);
+  startLCD(p_temp, mode);
 
-  SREG = tmpSREG;
+  LCD_IRQ_RESTORE(tmpSREG);
 }
 
-//convert ints to string
-void printIntLCD(struct s_lcd *p_lcd, int number)
+//private command, a handle on no bus for an init that can't be done, every call is a no op on it
+void initNone(struct s_lcd *p_temp, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base)
 {
-  uint8_t tmpSREG = 0;
+  memset(p_temp, 0, sizeof(struct s_lcd));
 
-  if(p_lcd == NULL) return;
+  p_temp->write = write_none;
+  invalidateGlyphsLCD(p_temp);
+  p_temp->screenSize = screenSize;
+  setGeometryLCD(p_temp, defaultGeometry(screenSize));
+  setTimingLCD(p_temp, &g_lcdTimingHD44780);
+  p_temp->width = width;
+  p_temp->precision = precision;
+  p_temp->base = base;
+  p_temp->lastExec = INS_REG;
+  p_temp->functionSet = (LCD_FUNCTIONSET | LCD_2LINE | LCD_5x8DOTS | LCD_4BITMODE);
+  p_temp->displaySetting = (LCD_DISPLAYCONTROL | LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF);
+  p_temp->entryModeSet = (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT);
+}
 
-  tmpSREG = SREG;
-  cli();
+//private command, skip the power on waits if the caller says so or a probe finds the controller running
+uint8_t warmStart(struct s_lcd *p_temp, uint8_t mode)
+{
+  //a byte the reset cut short may still be executing
+  if(g_initMode != LCD_INIT_COLD) waitExec(p_temp);
 
-  char buffer[p_lcd->screenSize];
+  if(g_initMode == LCD_INIT_WARM) return 1;
 
-  printLCD(p_lcd, ltoa(number, buffer, p_lcd->base));
+  //without R/W there is nothing to read back, play safe
+  if((g_initMode != LCD_INIT_PROBE) || !p_temp->rw) return 0;
 
-  SREG = tmpSREG;
-}
+  //picks the bus width for readByte until startLCD sets it for good
+  p_temp->functionSet = (mode ? LCD_8BITMODE : LCD_4BITMODE);
 
-//convert doubles to string
-void printDecLCD(struct s_lcd *p_lcd, double number)
-{
-  uint8_t tmpSREG = 0;
+  //still busy is a controller in its power on reset (the flag is D7, the first nibble in either mode), writing now isn't allowed
+  if(readByte(p_temp, INS_REG) & LCD_BUSYFLAG) return 0;
 
-  if(p_lcd == NULL) return;
+  //a controller in reset, in the other bus mode or half way through a nibble pair
+  //won't hand back both addresses (and a clear busy flag), so it gets the full sequence
+  lcdWrite(p_temp, (LCD_SETDDRAMADDR | 0x15), INS_REG);
 
-  tmpSREG = SREG;
-  cli();
+  if(readByte(p_temp, INS_REG) != 0x15) return 0;
 
-  char buffer[p_lcd->screenSize];
+  lcdWrite(p_temp, (LCD_SETDDRAMADDR | 0x4A), INS_REG);
 
-  printLCD(p_lcd, dtostrf(number, p_lcd->width, p_lcd->base, buffer));
+  return (readByte(p_temp, INS_REG) == 0x4A);
+}
 
-  SREG = tmpSREG;
+//private command, controller is in its bus mode, set the rest up the same way for every init
+void startLCD(struct s_lcd *p_temp, uint8_t mode)
+{
+  //function set again, this is once and for all
+  p_temp->functionSet = (LCD_FUNCTIONSET | LCD_2LINE | LCD_5x8DOTS | (mode ? LCD_8BITMODE : LCD_4BITMODE));
+  lcdWrite(p_temp, p_temp->functionSet, INS_REG);
+  //display control, enable display and setup cursor and blink
+  p_temp->displaySetting = (LCD_DISPLAYCONTROL | LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF);
+  lcdWrite(p_temp, p_temp->displaySetting, INS_REG);
+  //a warm display is taken to be unshifted, clear and home unshift it anyway
+  p_temp->viewShift = 0;
+  p_temp->scrubPhase = SCRUB_CHECK;
+  p_temp->scrubIndex = 0;
+  p_temp->scrubWait = 0;
+  p_temp->scrubRepairs = 0;
+  p_temp->scrubRestarts = 0;
+  //clear display and set cursor to home, a warm screen keeps its content and only the cursor goes home
+  if(p_temp->warm)
+  {
+    gotoAddr(p_temp, 0);
+  }
+  else
+  {
+    lcdWrite(p_temp, LCD_CLEARDISPLAY, INS_REG | LONG_EXEC);
+  }
+  //setup LCD entry mode
+  p_temp->entryModeSet = (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT);
+  lcdWrite(p_temp, p_temp->entryModeSet, INS_REG);
+  //the controller is in a known mode now, poll busy flag from here on if R/W is wired
+  p_temp->busyCheck = (p_temp->rw != 0);
+
+  syncLCD(p_temp);
 }
 
-//shift display to the left by one character
-void scrollDisplayLeftLCD(struct s_lcd *p_lcd)
+//setup LCD screen on a PCF8574 I2C backpack, always 4 bit mode
+void initLCD_twi(struct s_lcd *p_temp, twi_callback twiSend, uint8_t address, uint8_t *p_batch, uint8_t batchSize, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base)
 {
   uint8_t tmpSREG = 0;
 
-  if(p_lcd == NULL) return;
+  if(p_temp == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  if((twiSend == NULL) || (p_batch == NULL) || (batchSize < 2)) return;
 
-  p_lcd->write(p_lcd, (LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT), INS_REG);
+  LCD_IRQ_SAVE(tmpSREG);
 
-  SREG = tmpSREG;
+  p_temp->write = write_twi;
+  STAT_RESET(p_temp);
+  STAT_CALL(p_temp, LCD_STAT_INIT);
+  invalidateGlyphsLCD(p_temp);
+  p_temp->addrValid = 0;
+  p_temp->p_queue = NULL;
+  p_temp->p_shadow = NULL;
+  p_temp->p_dirty = NULL;
+  p_temp->p_map = NULL;
+  p_temp->twiSend = twiSend;
+  p_temp->twiAddr = address;
+  //100 kHz until setTwiClockLCD says otherwise
+  p_temp->twiByteUs = 90;
+  p_temp->backlight = LCD_PCF_BL;
+  p_temp->p_batch = p_batch;
+  p_temp->batchSize = batchSize;
+  p_temp->batchLen = 0;
+  p_temp->latch = 0;
+
+  p_temp->screenSize = screenSize;
+  setGeometryLCD(p_temp, defaultGeometry(screenSize));
+  setTimingLCD(p_temp, &g_lcdTimingHD44780);
+  p_temp->width = width;
+  p_temp->precision = precision;
+  p_temp->base = base;
+  p_temp->p_dataPort = NULL;
+  p_temp->p_ctrlPort = NULL;
+  p_temp->rs = 0;
+  p_temp->ena = 0;
+  p_temp->rw = 0;
+  p_temp->busyCheck = 0;
+  p_temp->lastExec = INS_REG;
+  //setup as defined in Hitachi Datasheet page 46, delays and all
+  //expander outputs come up high, E falling here would latch a byte into a controller still in reset
+  p_temp->warm = warmStart(p_temp, 0);
+  if(!p_temp->warm) _delay_ms(50);
+  //all lines low, R/W low means write
+  batchPut(p_temp, p_temp->backlight);
+  syncLCD(p_temp);
+  //0x3 on D7 to D4
+  twiNibble(p_temp, p_temp->backlight | 0x30);
+  syncLCD(p_temp);
+  if(!p_temp->warm) _delay_ms(5);
+  //a running controller only needs the execution time, the I2C transfer is longer than that
+  twiNibble(p_temp, p_temp->backlight | 0x30);
+  syncLCD(p_temp);
+  if(!p_temp->warm) _delay_us(150);
+  twiNibble(p_temp, p_temp->backlight | 0x30);
+  syncLCD(p_temp);
+  _delay_us(50);
+  //setup for 4 bit mode
+  twiNibble(p_temp, p_temp->backlight | 0x20);
+  syncLCD(p_temp);
+  _delay_us(50);
+
+  startLCD(p_temp, 0);
+
+  LCD_IRQ_RESTORE(tmpSREG);
 }
 
-//shift display to the right by one character
-void scrollDisplayRightLCD(struct s_lcd *p_lcd)
+//setup LCD screen behind 74HC595 shift registers on the hardware SPI
+void initLCD_spi(struct s_lcd *p_temp, volatile uint8_t *p_latchPort, uint8_t latch, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base)
 {
   uint8_t tmpSREG = 0;
 
-  if(p_lcd == NULL) return;
+  if(p_temp == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  if(p_latchPort == NULL) return;
 
-  p_lcd->write(p_lcd, (LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT), INS_REG);
+  LCD_IRQ_SAVE(tmpSREG);
 
-  SREG = tmpSREG;
+  p_temp->write = write_spi;
+  STAT_RESET(p_temp);
+  STAT_CALL(p_temp, LCD_STAT_INIT);
+  invalidateGlyphsLCD(p_temp);
+  p_temp->addrValid = 0;
+  p_temp->p_queue = NULL;
+  p_temp->p_shadow = NULL;
+  p_temp->p_dirty = NULL;
+  p_temp->p_map = NULL;
+  p_temp->twiSend = NULL;
+  p_temp->p_batch = NULL;
+  p_temp->batchLen = 0;
+  p_temp->latch = (1 << latch);
+  p_temp->spiSettle = 0;
+  p_temp->backlight = LCD_PCF_BL;
+
+  p_temp->screenSize = screenSize;
+  setGeometryLCD(p_temp, defaultGeometry(screenSize));
+  setTimingLCD(p_temp, &g_lcdTimingHD44780);
+  p_temp->width = width;
+  p_temp->precision = precision;
+  p_temp->base = base;
+  p_temp->p_dataPort = NULL;
+  p_temp->p_ctrlPort = p_latchPort;
+  p_temp->rs = 0;
+  p_temp->ena = 0;
+  p_temp->rw = 0;
+  p_temp->busyCheck = 0;
+  p_temp->lastExec = INS_REG;
+  //picks the register layout for write_spi until startLCD sets it for good
+  p_temp->functionSet = (mode ? LCD_8BITMODE : LCD_4BITMODE);
+  //RCLK idles low
+  LCD_PORT_OR(p_temp->p_ctrlPort - 1, p_temp->latch);
+  LCD_PORT_AND(p_temp->p_ctrlPort, ~(p_temp->latch));
+  LCD_SPI_INIT();
+  //setup as defined in Hitachi Datasheet page 45/46, delays and all
+  p_temp->warm = warmStart(p_temp, mode);
+  if(!p_temp->warm) _delay_ms(50);
+  //all lines low
+  spiUpdate(p_temp, 0x00, p_temp->backlight);
+  spiRclk(p_temp);
+  //0x3 on D7 to D4 is the 8 bit function set in both modes
+  //a running controller only needs the execution time
+  spiPulse(p_temp, 0x30, p_temp->backlight);
+  _delay_us(50);
+  if(!p_temp->warm) _delay_ms(5);
+  spiPulse(p_temp, 0x30, p_temp->backlight);
+  _delay_us(50);
+  if(!p_temp->warm) _delay_us(100);
+  spiPulse(p_temp, 0x30, p_temp->backlight);
+  _delay_us(50);
+  //setup
+  spiPulse(p_temp, (mode ? 0x30 : 0x20), p_temp->backlight);
+  _delay_us(50);
+
+  startLCD(p_temp, mode);
+
+  LCD_IRQ_RESTORE(tmpSREG);
 }
 
-//clear display, also sets cursor at home position, needs a long delay to work.
-void clearLCD(struct s_lcd *p_lcd)
+#ifdef HITACHI_LCD_STATIC
+//setup LCD screen with the pins from hitachiLcdConfig.h
+void initLCD_static(struct s_lcd *p_temp, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base)
 {
   uint8_t tmpSREG = 0;
 
-  if(p_lcd == NULL) return;
+  if(p_temp == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+#ifdef LCD_STATIC_RW
+  initLCD_customRW(p_temp, &LCD_STATIC_DATA_PORT, &LCD_STATIC_CTRL_PORT, LCD_STATIC_RS, LCD_STATIC_ENA, LCD_STATIC_RW, LCD_STATIC_MODE, screenSize, width, precision, base);
+#else
+  initLCD_customRW(p_temp, &LCD_STATIC_DATA_PORT, &LCD_STATIC_CTRL_PORT, LCD_STATIC_RS, LCD_STATIC_ENA, LCD_NO_RW, LCD_STATIC_MODE, screenSize, width, precision, base);
+#endif
 
-  p_lcd->write(p_lcd, LCD_CLEARDISPLAY, INS_REG);
-  _delay_ms(2);
+  LCD_IRQ_SAVE(tmpSREG);
 
-  SREG = tmpSREG;
+  //init sequence is shared, only the writes after it use the constant pins
+  p_temp->write = write_static;
+
+  LCD_IRQ_RESTORE(tmpSREG);
 }
+#endif
 
-//set cursor back to home position (0,0)
-void homeLCD(struct s_lcd *p_lcd)
+//backpack or shift register backlight on
+void backlightOnLCD(struct s_lcd *p_lcd)
 {
   uint8_t tmpSREG = 0;
 
   if(p_lcd == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  if((p_lcd->twiSend == NULL) && !p_lcd->latch) return;
 
-  p_lcd->write(p_lcd, LCD_RETURNHOME, INS_REG);
-  _delay_ms(2);
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
 
-  SREG = tmpSREG;
+  p_lcd->backlight = LCD_PCF_BL;
+  putBacklight(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
 }
 
-//turn off dispaly
-void displayOffLCD(struct s_lcd *p_lcd)
+//backpack or shift register backlight off
+void backlightOffLCD(struct s_lcd *p_lcd)
 {
   uint8_t tmpSREG = 0;
 
   if(p_lcd == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  if((p_lcd->twiSend == NULL) && !p_lcd->latch) return;
 
-  p_lcd->displaySetting &= ~LCD_DISPLAYON;
-  p_lcd->write(p_lcd, p_lcd->displaySetting, INS_REG);
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
 
-  SREG = tmpSREG;
+  p_lcd->backlight = 0;
+  putBacklight(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
 }
 
-//turn on display
-void displayOnLCD(struct s_lcd *p_lcd)
+//private command, update the backlight output with E low
+void putBacklight(struct s_lcd *p_lcd)
 {
-  uint8_t tmpSREG = 0;
-
-  if(p_lcd == NULL) return;
-
-  tmpSREG = SREG;
-  cli();
-
-  p_lcd->displaySetting |= LCD_DISPLAYON;
-  p_lcd->write(p_lcd, p_lcd->displaySetting, INS_REG);
+  if(p_lcd->latch)
+  {
+    spiUpdate(p_lcd, 0, p_lcd->backlight);
+    spiRclk(p_lcd);
+    return;
+  }
 
-  SREG = tmpSREG;
+  batchPut(p_lcd, p_lcd->backlight);
+  syncLCD(p_lcd);
 }
 
-//turn off cursor
-void cursorOffLCD(struct s_lcd *p_lcd)
+//copy a screen layout out of flash
+void setGeometryLCD(struct s_lcd *p_lcd, const struct s_lcdGeometry *p_geometry)
 {
-  uint8_t tmpSREG = 0;
+  uint8_t index = 0;
 
   if(p_lcd == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  if(p_geometry == NULL) return;
 
-  p_lcd->displaySetting &= ~LCD_CURSORON;
-  p_lcd->write(p_lcd, p_lcd->displaySetting, INS_REG);
+  for(index = 0; index < sizeof(struct s_lcdGeometry); index++)
+  {
+    ((uint8_t *)&p_lcd->geometry)[index] = pgm_read_byte((const uint8_t *)p_geometry + index);
+  }
 
-  SREG = tmpSREG;
+  p_lcd->wrapAddr = NO_WRAP;
 }
 
-//turn on cursor
-void cursorOnLCD(struct s_lcd *p_lcd)
+//copy controller timings out of flash and turn them into delay loop counts for this F_CPU
+void setTimingLCD(struct s_lcd *p_lcd, const struct s_lcdTiming *p_timing)
 {
-  uint8_t tmpSREG = 0;
+  uint8_t index = 0;
+  uint16_t pulse = 0;
 
   if(p_lcd == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  if(p_timing == NULL) return;
 
-  p_lcd->displaySetting |= LCD_CURSORON;
-  p_lcd->write(p_lcd, p_lcd->displaySetting, INS_REG);
+  for(index = 0; index < sizeof(struct s_lcdTiming); index++)
+  {
+    ((uint8_t *)&p_lcd->timing)[index] = pgm_read_byte((const uint8_t *)p_timing + index);
+  }
 
-  SREG = tmpSREG;
+  p_lcd->execLoops = loops2(p_lcd->timing.execUs);
+  p_lcd->longLoops = loops2(p_lcd->timing.longUs);
+
+  //_delay_loop_1 is 3 cycles a loop, rounded up, 0 would be 256 loops
+  pulse = (uint16_t)((((uint32_t)p_lcd->timing.pulseNs * (F_CPU / 1000UL)) + 2999999UL) / 3000000UL);
+  p_lcd->pulseLoops = (pulse ? (pulse > 255 ? 255 : pulse) : 1);
+
+  if(p_lcd->write == write_twi) twiSettle(p_lcd);
 }
 
-//turn off blinking cursor
-void blinkOffLCD(struct s_lcd *p_lcd)
+//set the I2C clock of a PCF8574 backpack, pads the expander bytes out to the settle time
+void setTwiClockLCD(struct s_lcd *p_lcd, uint32_t frequency)
 {
-  uint8_t tmpSREG = 0;
-
   if(p_lcd == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  if((p_lcd->write != write_twi) || !frequency) return;
 
-  p_lcd->displaySetting &= ~LCD_BLINKON;
-  p_lcd->write(p_lcd, p_lcd->displaySetting, INS_REG);
+  //9 clocks a byte with the ACK, rounded down so the padding errs long
+  p_lcd->twiByteUs = (uint16_t)(9000000UL / frequency);
 
-  SREG = tmpSREG;
+  twiSettle(p_lcd);
 }
 
-//turn of blinking cursor
-void blinkOnLCD(struct s_lcd *p_lcd)
+//private command, idle expander bytes so the two of a top nibble plus those last the exec time
+void twiSettle(struct s_lcd *p_lcd)
 {
-  uint8_t tmpSREG = 0;
+  uint16_t covered = 2 * p_lcd->twiByteUs;
 
-  if(p_lcd == NULL) return;
+  if(!p_lcd->twiByteUs || (p_lcd->timing.execUs <= covered))
+  {
+    p_lcd->twiPad = 0;
+    return;
+  }
 
-  tmpSREG = SREG;
-  cli();
+  p_lcd->twiPad = (uint8_t)((p_lcd->timing.execUs - covered + p_lcd->twiByteUs - 1) / p_lcd->twiByteUs);
+}
 
-  p_lcd->displaySetting |= LCD_BLINKON;
-  p_lcd->write(p_lcd, p_lcd->displaySetting, INS_REG);
+//private command, _delay_loop_2 count for us, 4 cycles a loop rounded up, never 0 (65536 loops)
+uint16_t loops2(uint16_t us)
+{
+  uint32_t loops = (((uint32_t)us * (F_CPU / 1000UL)) + 3999UL) / 4000UL;
 
-  SREG = tmpSREG;
+  return (loops ? (loops > 0xFFFF ? 0xFFFF : loops) : 1);
 }
 
-//set text to flow Left to Right
-void leftToRightLCD(struct s_lcd *p_lcd)
+//private command, layout init starts with, 80 characters could be 40x2 as well
+const struct s_lcdGeometry *defaultGeometry(uint8_t screenSize)
+{
+  switch(screenSize)
+  {
+    case 16:
+      return &g_lcdGeometry16x1;
+    case 40:
+      return &g_lcdGeometry20x2;
+    case 64:
+      return &g_lcdGeometry16x4;
+    case 80:
+      return &g_lcdGeometry20x4;
+    default:
+      return &g_lcdGeometry16x2;
+  }
+}
+
+//print string array to display
+void printLCD(struct s_lcd *p_lcd, char *message)
 {
   uint8_t tmpSREG = 0;
 
   if(p_lcd == NULL) return;
 
-  tmpSREG = SREG;
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  //as long as pointer isn't pointing to null
+  while(*message != '\0')
+  {
+    //write current character from string
+    putChar(p_lcd, (uint8_t)*message);
+    message++;
+
+  }
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//print string stored in flash, saves the RAM copy of constant labels
+void printLCD_P(struct s_lcd *p_lcd, const char *p_message)
+{
+  uint8_t tmpSREG = 0;
+  char data = 0;
+
+  if(p_lcd == NULL) return;
+
+  if(p_message == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  while((data = pgm_read_byte(p_message)) != '\0')
+  {
+    putChar(p_lcd, (uint8_t)data);
+    p_message++;
+  }
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//replay a precompiled screen from flash
+void runScreenLCD(struct s_lcd *p_lcd, const uint8_t *p_program, const uint8_t * const *pp_glyphs, uint8_t glyphCount, field_callback field)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t op = 0;
+  uint8_t arg = 0;
+  uint8_t width = 0;
+
+  if(p_lcd == NULL) return;
+
+  if(p_program == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_SCREEN);
+
+  for(;;)
+  {
+    op = pgm_read_byte(p_program++);
+
+    //characters are most of a program, check them first
+    if(op >= 0x20)
+    {
+      putChar(p_lcd, op);
+      continue;
+    }
+
+    switch(op)
+    {
+      case LCD_SCR_CURSOR:
+        arg = pgm_read_byte(p_program++);
+        op = pgm_read_byte(p_program++);
+        //same as setCursorLCD, only sent if the address counter is elsewhere
+        gotoAddr(p_lcd, cellAddr(p_lcd, (arg < p_lcd->geometry.rows ? arg : 0), op));
+        break;
+      case LCD_SCR_GLYPH:
+        arg = pgm_read_byte(p_program++);
+        //no table or an index past it prints a blank
+        putChar(p_lcd, (((pp_glyphs != NULL) && (arg < glyphCount)) ? glyphLCD(p_lcd, pp_glyphs[arg]) : ' '));
+        break;
+      case LCD_SCR_FIELD:
+        arg = pgm_read_byte(p_program++);
+        width = pgm_read_byte(p_program++);
+
+        if(field != NULL)
+        {
+          field(p_lcd, arg, width);
+          break;
+        }
+
+        for(; width > 0; width--) putChar(p_lcd, ' ');
+        break;
+      case LCD_SCR_RAW:
+        putChar(p_lcd, pgm_read_byte(p_program++));
+        break;
+      case LCD_SCR_CLEAR:
+        lcdWrite(p_lcd, LCD_CLEARDISPLAY, INS_REG | LONG_EXEC);
+        break;
+      case LCD_SCR_END:
+      default:
+        syncLCD(p_lcd);
+
+        LCD_IRQ_RESTORE(tmpSREG);
+        return;
+    }
+  }
+}
+
+void printSpecialLCD(struct s_lcd *p_lcd, uint8_t message)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  //write current character
+  putChar(p_lcd, message);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//bind a stdio stream, printf output goes straight to the display without a buffer
+FILE *openStreamLCD(struct s_lcd *p_lcd, FILE *p_stream)
+{
+#ifdef HITACHI_LCD_HOST
+  FILE *p_file = NULL;
+  cookie_io_functions_t functions = {NULL, streamWrite, NULL, NULL};
+
+  (void)p_stream;
+
+  if(p_lcd == NULL) return NULL;
+
+  p_file = fopencookie(p_lcd, "w", functions);
+
+  //unbuffered so output shows up like it does on the AVR
+  if(p_file != NULL) setvbuf(p_file, NULL, _IONBF, 0);
+
+  return p_file;
+#else
+  if((p_lcd == NULL) || (p_stream == NULL)) return NULL;
+
+  fdev_setup_stream(p_stream, streamPut, NULL, _FDEV_SETUP_WRITE);
+  fdev_set_udata(p_stream, p_lcd);
+
+  return p_stream;
+#endif
+}
+
+//convert ints to string, other bases than 10 print the two's complement like ltoa did
+void printIntLCD(struct s_lcd *p_lcd, int number)
+{
+  if(p_lcd == NULL) return;
+
+  if(p_lcd->base == 10)
+  {
+    printSignedLCD(p_lcd, number, 10, 0, 0);
+    return;
+  }
+
+  printUnsignedLCD(p_lcd, (uint32_t)(int32_t)number, p_lcd->base, 0, 0);
+}
+
+//convert doubles to string, integer and fraction parts converted apart so only a multiply and a convert are pulled from the float library
+void printDecLCD(struct s_lcd *p_lcd, double number)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t precision = 0;
+  uint8_t count = 0;
+  uint32_t scale = 0;
+  uint32_t integer = 0;
+  uint32_t frac = 0;
+  uint8_t overflow = 0;
+  char sign = 0;
+
+  if(p_lcd == NULL) return;
+
+  precision = (p_lcd->precision > 9 ? 9 : p_lcd->precision);
+  scale = pgm_read_dword(&g_pow10[precision]);
+
+  if(number < 0)
+  {
+    sign = '-';
+    number = -number;
+  }
+
+  //NaN fails every compare, it and integer parts past 32 bits can't be shown
+  if(number < 4294967296.0)
+  {
+    //integer and fraction converted apart, each fits 32 bits
+    integer = (uint32_t)number;
+    frac = (uint32_t)(((number - integer) * scale) + 0.5);
+
+    if(frac >= scale)
+    {
+      frac -= scale;
+
+      if(integer == 0xFFFFFFFFUL) overflow = 1;
+      else integer++;
+    }
+  }
+  else
+  {
+    overflow = 1;
+  }
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  if(overflow)
+  {
+    for(count = 0; (count < p_lcd->width) || !count; count++) putChar(p_lcd, '#');
+  }
+  else
+  {
+    putNumber(p_lcd, sign, integer, 10, precision, frac, p_lcd->width, 0);
+  }
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//signed number in any base from 2 to 36
+void printSignedLCD(struct s_lcd *p_lcd, int32_t number, uint8_t base, uint8_t width, uint8_t flags)
+{
+  uint8_t tmpSREG = 0;
+  char sign = ((flags & LCD_FMT_PLUS) ? '+' : 0);
+
+  if(p_lcd == NULL) return;
+
+  if(number < 0) sign = '-';
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  putNumber(p_lcd, sign, (number < 0 ? -(uint32_t)number : (uint32_t)number), base, 0, 0, width, flags);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//unsigned number in any base from 2 to 36
+void printUnsignedLCD(struct s_lcd *p_lcd, uint32_t number, uint8_t base, uint8_t width, uint8_t flags)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  putNumber(p_lcd, 0, number, base, 0, 0, width, flags);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//hex is just unsigned base 16, digits come from shifts instead of divides
+void printHexLCD(struct s_lcd *p_lcd, uint32_t number, uint8_t width, uint8_t flags)
+{
+  printUnsignedLCD(p_lcd, number, 16, width, flags);
+}
+
+//Q format fixed point, fraction digits come from multiplying the fraction bits by 10
+void printFixedLCD(struct s_lcd *p_lcd, int32_t number, uint8_t fracBits, uint8_t precision, uint8_t width, uint8_t flags)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t index = 0;
+  uint32_t magnitude = 0;
+  uint32_t mask = 0;
+  uint32_t frac = 0;
+  uint32_t digits = 0;
+  uint32_t integer = 0;
+  char sign = ((flags & LCD_FMT_PLUS) ? '+' : 0);
+
+  if(p_lcd == NULL) return;
+
+  //frac * 10 has to fit 32 bits
+  if(fracBits > 28) fracBits = 28;
+
+  if(precision > 9) precision = 9;
+
+  if(number < 0) sign = '-';
+
+  magnitude = (number < 0 ? -(uint32_t)number : (uint32_t)number);
+  mask = ((uint32_t)1 << fracBits) - 1;
+  integer = magnitude >> fracBits;
+  frac = magnitude & mask;
+
+  for(index = 0; index < precision; index++)
+  {
+    frac *= 10;
+    digits = (digits * 10) + (frac >> fracBits);
+    frac &= mask;
+  }
+
+  //round on the digit after the last printed one, 0.96 at one digit carries into 1.0
+  if(((frac * 10) >> fracBits) >= 5)
+  {
+    digits++;
+
+    if(digits == pgm_read_dword(&g_pow10[precision]))
+    {
+      digits = 0;
+      integer++;
+    }
+  }
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  putNumber(p_lcd, sign, integer, 10, precision, digits, width, flags);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//shift display to the left by one character
+void scrollDisplayLeftLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  lcdWrite(p_lcd, (LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT), INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//shift display to the right by one character
+void scrollDisplayRightLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  lcdWrite(p_lcd, (LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT), INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//clear display, also sets cursor at home position, needs a long delay to work.
+void clearLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CLEAR);
+
+  lcdWrite(p_lcd, LCD_CLEARDISPLAY, INS_REG | LONG_EXEC);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//set cursor back to home position (0,0)
+void homeLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CURSOR);
+
+  lcdWrite(p_lcd, LCD_RETURNHOME, INS_REG | LONG_EXEC);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//turn off dispaly
+void displayOffLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->displaySetting &= ~LCD_DISPLAYON;
+  lcdWrite(p_lcd, p_lcd->displaySetting, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//turn on display
+void displayOnLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->displaySetting |= LCD_DISPLAYON;
+  lcdWrite(p_lcd, p_lcd->displaySetting, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//turn off cursor
+void cursorOffLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->displaySetting &= ~LCD_CURSORON;
+  lcdWrite(p_lcd, p_lcd->displaySetting, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//turn on cursor
+void cursorOnLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->displaySetting |= LCD_CURSORON;
+  lcdWrite(p_lcd, p_lcd->displaySetting, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//turn off blinking cursor
+void blinkOffLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->displaySetting &= ~LCD_BLINKON;
+  lcdWrite(p_lcd, p_lcd->displaySetting, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//turn of blinking cursor
+void blinkOnLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->displaySetting |= LCD_BLINKON;
+  lcdWrite(p_lcd, p_lcd->displaySetting, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//set text to flow Left to Right
+void leftToRightLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->entryModeSet |= LCD_ENTRYLEFT;
+  lcdWrite(p_lcd, p_lcd->entryModeSet, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//set text to flow Right to Left
+void rightToLeftLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->entryModeSet &= ~LCD_ENTRYLEFT;
+  lcdWrite(p_lcd, p_lcd->entryModeSet, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+// This will 'right justify' text from the cursor
+void autoscrollOnLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->entryModeSet |= LCD_ENTRYSHIFTINCREMENT;
+  lcdWrite(p_lcd, p_lcd->entryModeSet, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+// This will 'left justify' text from the cursor
+void autoscrollOffLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CONTROL);
+
+  p_lcd->entryModeSet &= ~LCD_ENTRYSHIFTINCREMENT;
+  lcdWrite(p_lcd, p_lcd->entryModeSet, INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//allows a cursor to be set, row start comes from the geometry and col is used as an offset.
+void setCursorLCD(struct s_lcd *p_lcd, uint8_t row, uint8_t col)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_CURSOR);
+
+  //rows off the screen land on the first row
+  if(row >= p_lcd->geometry.rows) row = 0;
+
+  gotoAddr(p_lcd, cellAddr(p_lcd, row, col));
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//upload 8 rows of a glyph, restores the DDRAM address afterwards if it was known
+void loadGlyphLCD(struct s_lcd *p_lcd, uint8_t slot, const uint8_t *p_glyph)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t addr = 0;
+  uint8_t addrValid = 0;
+  uint8_t index = 0;
+
+  if(p_lcd == NULL) return;
+
+  if((p_glyph == NULL) || (slot >= LCD_GLYPH_SLOTS)) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_GLYPH);
+
+  addr = p_lcd->addr;
+  addrValid = p_lcd->addrValid;
+
+  //decrement mode walks CGRAM backwards, start on the last row instead of changing entry mode
+  if(p_lcd->entryModeSet & LCD_ENTRYLEFT)
+  {
+    lcdWrite(p_lcd, (LCD_SETCGRAMADDR | (slot << 3)), INS_REG);
+
+    for(index = 0; index < 8; index++)
+    {
+      lcdWrite(p_lcd, pgm_read_byte(p_glyph + index), DATA_REG);
+    }
+  }
+  else
+  {
+    lcdWrite(p_lcd, (LCD_SETCGRAMADDR | (slot << 3) | 0x07), INS_REG);
+
+    for(index = 8; index > 0; index--)
+    {
+      lcdWrite(p_lcd, pgm_read_byte(p_glyph + index - 1), DATA_REG);
+    }
+  }
+
+  if(addrValid) lcdWrite(p_lcd, (LCD_SETDDRAMADDR | addr), INS_REG);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//cache lookup, least recently used slot is replaced on a miss
+uint8_t glyphLCD(struct s_lcd *p_lcd, const uint8_t *p_glyph)
+{
+  uint8_t index = 0;
+  uint8_t slot = 0;
+
+  if(p_lcd == NULL) return 0;
+
+  //NULL marks an empty slot, don't match it or cache it
+  if(p_glyph == NULL) return ' ';
+
+  //look for it, stop at the oldest entry which is the victim if missing
+  for(index = 0; index < (LCD_GLYPH_SLOTS - 1); index++)
+  {
+    if(p_lcd->p_glyphs[p_lcd->glyphOrder[index]] == p_glyph) break;
+  }
+
+  slot = p_lcd->glyphOrder[index];
+
+  if(p_lcd->p_glyphs[slot] != p_glyph)
+  {
+    loadGlyphLCD(p_lcd, slot, p_glyph);
+    p_lcd->p_glyphs[slot] = p_glyph;
+  }
+
+  //move to the front as most recently used
+  for(; index > 0; index--)
+  {
+    p_lcd->glyphOrder[index] = p_lcd->glyphOrder[index - 1];
+  }
+
+  p_lcd->glyphOrder[0] = slot;
+
+  return slot;
+}
+
+//empty the residency table
+void invalidateGlyphsLCD(struct s_lcd *p_lcd)
+{
+  uint8_t index = 0;
+
+  if(p_lcd == NULL) return;
+
+  for(index = 0; index < LCD_GLYPH_SLOTS; index++)
+  {
+    p_lcd->p_glyphs[index] = NULL;
+    p_lcd->glyphOrder[index] = index;
+  }
+}
+
+//forget the tracked address, the next cursor move always goes out
+void invalidateCursorLCD(struct s_lcd *p_lcd)
+{
+  if(p_lcd == NULL) return;
+
+  p_lcd->addrValid = 0;
+}
+
+//attach RAM mirror of the display, everything starts dirty since the display is unknown
+void attachShadowLCD(struct s_lcd *p_lcd, uint8_t *p_shadow, uint8_t *p_dirty, uint8_t rows, uint8_t cols)
+{
+  uint16_t index = 0;
+
+  if(p_lcd == NULL) return;
+
+  p_lcd->p_shadow = p_shadow;
+  p_lcd->p_dirty = p_dirty;
+  p_lcd->rows = (rows ? rows : p_lcd->geometry.rows);
+  p_lcd->cols = (cols ? cols : p_lcd->geometry.cols);
+  rows = p_lcd->rows;
+  cols = p_lcd->cols;
+
+  if((p_shadow == NULL) || (p_dirty == NULL))
+  {
+    p_lcd->p_shadow = NULL;
+    p_lcd->p_dirty = NULL;
+    return;
+  }
+
+  for(index = 0; index < ((uint16_t)rows * cols); index++)
+  {
+    p_shadow[index] = ' ';
+  }
+
+  invalidateShadowLCD(p_lcd);
+}
+
+//print string into the shadow, stops at the end of the row
+void printShadowLCD(struct s_lcd *p_lcd, uint8_t row, uint8_t col, char *message)
+{
+  if(p_lcd == NULL) return;
+
+  if(p_lcd->p_shadow == NULL) return;
+
+  while((*message != '\0') && (col < p_lcd->cols))
+  {
+    putShadowLCD(p_lcd, row, col, (uint8_t)*message);
+    message++;
+    col++;
+  }
+}
+
+//place one byte in the shadow, only marks the cell dirty if it really changed
+void putShadowLCD(struct s_lcd *p_lcd, uint8_t row, uint8_t col, uint8_t message)
+{
+  uint16_t index = 0;
+
+  if(p_lcd == NULL) return;
+
+  if(p_lcd->p_shadow == NULL) return;
+
+  if((row >= p_lcd->rows) || (col >= p_lcd->cols)) return;
+
+  index = ((uint16_t)row * p_lcd->cols) + col;
+
+  if(p_lcd->p_shadow[index] == message) return;
+
+  p_lcd->p_shadow[index] = message;
+  p_lcd->p_dirty[index >> 3] |= (1 << (index & 0x07));
+}
+
+//blank the shadow, the display is only touched by flushLCD
+void clearShadowLCD(struct s_lcd *p_lcd)
+{
+  uint8_t row = 0;
+  uint8_t col = 0;
+
+  if(p_lcd == NULL) return;
+
+  for(row = 0; row < p_lcd->rows; row++)
+  {
+    for(col = 0; col < p_lcd->cols; col++)
+    {
+      putShadowLCD(p_lcd, row, col, ' ');
+    }
+  }
+}
+
+//force the next flush to rewrite every cell
+void invalidateShadowLCD(struct s_lcd *p_lcd)
+{
+  uint16_t index = 0;
+
+  if(p_lcd == NULL) return;
+
+  if(p_lcd->p_dirty == NULL) return;
+
+  for(index = 0; index < LCD_SHADOW_DIRTY_SIZE(p_lcd->rows, p_lcd->cols); index++)
+  {
+    p_lcd->p_dirty[index] = MASK_8BIT_FF;
+  }
+}
+
+//open a window on the shadow, clipped to it
+void openWindowLCD(struct s_lcd *p_lcd, struct s_lcdWindow *p_window, uint8_t row, uint8_t col, uint8_t rows, uint8_t cols, uint8_t flags)
+{
+  if((p_lcd == NULL) || (p_window == NULL)) return;
+
+  //a window off the shadow is empty, everything printed to it is cut off
+  if(row > p_lcd->rows) row = p_lcd->rows;
+
+  if(col > p_lcd->cols) col = p_lcd->cols;
+
+  if(!rows || (rows > (p_lcd->rows - row))) rows = p_lcd->rows - row;
+
+  if(!cols || (cols > (p_lcd->cols - col))) cols = p_lcd->cols - col;
+
+  p_window->row = row;
+  p_window->col = col;
+  p_window->rows = rows;
+  p_window->cols = cols;
+  p_window->flags = flags;
+
+  setCursorWindowLCD(p_window, 0, 0);
+}
+
+//print into the window at its cursor, wrapping, scrolling or cutting off as the flags say
+void printWindowLCD(struct s_lcd *p_lcd, struct s_lcdWindow *p_window, char *message)
+{
+  if((p_lcd == NULL) || (p_window == NULL) || (message == NULL)) return;
+
+  for(; *message != '\0'; message++)
+  {
+    switch(*message)
+    {
+      case '\f':
+        clearWindowLCD(p_lcd, p_window);
+        break;
+      case '\n':
+        windowLine(p_lcd, p_window);
+        break;
+      case '\r':
+        p_window->cursorCol = 0;
+        break;
+      default:
+        //the wrap is owed until a character needs it, so filling the last line doesn't scroll
+        if((p_window->cursorCol >= p_window->cols) && (p_window->flags & LCD_WIN_WRAP)) windowLine(p_lcd, p_window);
+
+        if((p_window->cursorCol < p_window->cols) && (p_window->cursorRow < p_window->rows))
+        {
+          putShadowLCD(p_lcd, p_window->row + p_window->cursorRow, p_window->col + p_window->cursorCol, (uint8_t)*message);
+          p_window->cursorCol++;
+        }
+        break;
+    }
+  }
+}
+
+//move the window cursor, clipped to the window
+void setCursorWindowLCD(struct s_lcdWindow *p_window, uint8_t row, uint8_t col)
+{
+  if(p_window == NULL) return;
+
+  p_window->cursorRow = ((row < p_window->rows) ? row : p_window->rows);
+  p_window->cursorCol = ((col < p_window->cols) ? col : p_window->cols);
+}
+
+//blank the window in the shadow
+void clearWindowLCD(struct s_lcd *p_lcd, struct s_lcdWindow *p_window)
+{
+  uint8_t row = 0;
+  uint8_t col = 0;
+
+  if((p_lcd == NULL) || (p_window == NULL)) return;
+
+  for(row = 0; row < p_window->rows; row++)
+  {
+    for(col = 0; col < p_window->cols; col++)
+    {
+      putShadowLCD(p_lcd, p_window->row + row, p_window->col + col, ' ');
+    }
+  }
+
+  setCursorWindowLCD(p_window, 0, 0);
+}
+
+//move the window up a line inside the shadow, only cells that change end up dirty
+void scrollWindowLCD(struct s_lcd *p_lcd, struct s_lcdWindow *p_window)
+{
+  uint8_t row = 0;
+  uint8_t col = 0;
+
+  if((p_lcd == NULL) || (p_window == NULL)) return;
+
+  if(p_lcd->p_shadow == NULL) return;
+
+  for(row = 0; row < p_window->rows; row++)
+  {
+    for(col = 0; col < p_window->cols; col++)
+    {
+      if((row + 1) < p_window->rows)
+      {
+        putShadowLCD(p_lcd, p_window->row + row, p_window->col + col, p_lcd->p_shadow[((uint16_t)(p_window->row + row + 1) * p_lcd->cols) + p_window->col + col]);
+      }
+      else
+      {
+        putShadowLCD(p_lcd, p_window->row + row, p_window->col + col, ' ');
+      }
+    }
+  }
+}
+
+//send dirty runs of the shadow, one address command per run of adjacent cells
+void flushLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t row = 0;
+  uint8_t col = 0;
+  uint8_t rank = 0;
+  uint8_t entryModeSet = 0;
+  uint8_t order[LCD_GEOMETRY_ROWS];
+  uint16_t index = 0;
+
+  if(p_lcd == NULL) return;
+
+  if(p_lcd->p_shadow == NULL) return;
+
+  //rows in DDRAM address order so a run can go on from the end of a row into the next one in DDRAM
+  for(row = 0; (row < p_lcd->rows) && (row < LCD_GEOMETRY_ROWS); row++)
+  {
+    for(rank = row; (rank > 0) && (cellAddr(p_lcd, order[rank - 1], 0) > cellAddr(p_lcd, row, 0)); rank--)
+    {
+      order[rank] = order[rank - 1];
+    }
+
+    order[rank] = row;
+  }
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_FLUSH);
+
+  entryModeSet = plainEntry(p_lcd);
+
+  for(rank = 0; rank < p_lcd->rows; rank++)
+  {
+    //shadows with more rows than a geometry has go in screen order
+    row = ((p_lcd->rows <= LCD_GEOMETRY_ROWS) ? order[rank] : rank);
+    index = (uint16_t)row * p_lcd->cols;
+
+    for(col = 0; col < p_lcd->cols; col++, index++)
+    {
+      if(!(p_lcd->p_dirty[index >> 3] & (1 << (index & 0x07)))) continue;
+
+      //only the first cell of a run needs an address, the rest follow the address counter
+      gotoAddr(p_lcd, cellAddr(p_lcd, row, col));
+
+      lcdWrite(p_lcd, p_lcd->p_shadow[index], DATA_REG);
+      p_lcd->p_dirty[index >> 3] &= ~(1 << (index & 0x07));
+    }
+  }
+
+  restoreEntry(p_lcd, entryModeSet);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//flush several shadows, LCD_GROUP_MAX at a time
+void flushGroupLCD(struct s_lcd **pp_lcd, uint8_t count)
+{
+  uint8_t chunk = 0;
+
+  if(pp_lcd == NULL) return;
+
+  for(; count > 0; count -= chunk, pp_lcd += chunk)
+  {
+    chunk = ((count > LCD_GROUP_MAX) ? LCD_GROUP_MAX : count);
+    groupFlush(pp_lcd, chunk);
+  }
+}
+
+//private command, flush up to LCD_GROUP_MAX shadows, one byte per display per round so their settle times overlap
+void groupFlush(struct s_lcd **pp_lcd, uint8_t count)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t index = 0;
+  uint8_t active = 0;
+  uint16_t wait = 0;
+  uint16_t settle = 0;
+  uint8_t entryModeSet[LCD_GROUP_MAX];
+  uint16_t cell[LCD_GROUP_MAX];
+  struct s_lcd *p_group[LCD_GROUP_MAX];
+
+  LCD_IRQ_SAVE(tmpSREG);
+
+  for(index = 0; index < count; index++)
+  {
+    p_group[index] = pp_lcd[index];
+    cell[index] = 0;
+
+    if(p_group[index] == NULL) continue;
+
+    if(p_group[index]->p_shadow == NULL)
+    {
+      p_group[index] = NULL;
+      continue;
+    }
+
+    //the queue owns its bus and serial buses can't be strobed here, those go on their own
+    if((p_group[index]->p_queue != NULL) || !parallelBus(p_group[index]))
+    {
+      flushLCD(p_group[index]);
+      p_group[index] = NULL;
+      continue;
+    }
+
+    STAT_CALL(p_group[index], LCD_STAT_FLUSH);
+
+    //the slowest panel sets the pace of a round
+    if(p_group[index]->timing.execUs > settle) settle = p_group[index]->timing.execUs;
+
+    entryModeSet[index] = plainEntry(p_group[index]);
+
+    //the last direct write may still be executing
+    if(p_group[index]->busyCheck) waitReady(p_group[index], INS_REG);
+  }
+
+  do
+  {
+    active = 0;
+
+    for(index = 0; index < count; index++)
+    {
+      if(p_group[index] == NULL) continue;
+
+      active += groupStep(p_group[index], &cell[index]);
+    }
+
+    if(!active) break;
+
+    //strobes are well under a microsecond with the profile pulses, so the settle time isn't shortened by them
+    for(wait = settle; wait > 0; wait--) _delay_us(1);
+
+    //the wait is shared, book it once to the first panel of the round
+    for(index = 0; p_group[index] == NULL; index++);
+    STAT_DELAY(p_group[index], settle);
+  } while(active);
+
+  for(index = 0; index < count; index++)
+  {
+    if(p_group[index] == NULL) continue;
+
+    //next direct write polls from a known state
+    p_group[index]->lastExec = INS_REG;
+
+    restoreEntry(p_group[index], entryModeSet[index]);
+  }
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//private command, send the next byte of a group flush, 0 when nothing is left
+uint8_t groupStep(struct s_lcd *p_lcd, uint16_t *p_index)
+{
+  uint16_t size = (uint16_t)p_lcd->rows * p_lcd->cols;
+  uint8_t addr = 0;
+
+  //skip clean cells, a whole clean byte of the bitmap at a time
+  while((*p_index < size) && !(p_lcd->p_dirty[*p_index >> 3] & (1 << (*p_index & 0x07))))
+  {
+    *p_index = (p_lcd->p_dirty[*p_index >> 3] ? *p_index + 1 : (*p_index | 0x07) + 1);
+  }
+
+  if(*p_index >= size) return 0;
+
+  addr = cellAddr(p_lcd, *p_index / p_lcd->cols, *p_index % p_lcd->cols);
+
+  //start of a run, this round only moves the address counter
+  if(!p_lcd->addrValid || (p_lcd->addr != addr))
+  {
+    strobeByte(p_lcd, LCD_SETDDRAMADDR | addr, INS_REG);
+    trackAddr(p_lcd, LCD_SETDDRAMADDR | addr, INS_REG);
+    return 1;
+  }
+
+  strobeByte(p_lcd, p_lcd->p_shadow[*p_index], DATA_REG);
+  trackAddr(p_lcd, p_lcd->p_shadow[*p_index], DATA_REG);
+  p_lcd->p_dirty[*p_index >> 3] &= ~(1 << (*p_index & 0x07));
+  (*p_index)++;
+
+  return 1;
+}
+
+//private command, 1 if the display is on a parallel bus strobeByte can drive
+uint8_t parallelBus(struct s_lcd *p_lcd)
+{
+  write_callback write = p_lcd->write;
+
+#ifdef HITACHI_LCD_STATIC
+  if(write == write_static) return 1;
+#endif
+
+  return ((write == write_4bit) || (write == write_8bit) || (write == write_4bit_map) || (write == write_8bit_map));
+}
+
+//private command, put a byte on a parallel bus without waiting for it to settle
+void strobeByte(struct s_lcd *p_lcd, uint8_t data, int regSel)
+{
+  write_callback write = p_lcd->write;
+
+  STAT_BYTE(p_lcd, regSel);
+
+#ifdef HITACHI_LCD_STATIC
+  if(write == write_static)
+  {
+    staticRegSel(regSel);
+#if LCD_STATIC_MODE
+    LCD_PORT_WRITE(&LCD_STATIC_DATA_PORT, data);
+    staticStrobe(p_lcd);
+#else
+    staticNibble(data >> 4);
+    staticStrobe(p_lcd);
+    staticNibble(data);
+    staticStrobe(p_lcd);
+#endif
+    return;
+  }
+#endif
+
+  setRegSel(p_lcd, regSel);
+
+  if(write == write_8bit)
+  {
+    LCD_PORT_WRITE(p_lcd->p_dataPort, data);
+  }
+  else if(write == write_8bit_map)
+  {
+    putMap(p_lcd, data);
+  }
+  else if(write == write_4bit_map)
+  {
+    putMap(p_lcd, data & 0xF0);
+    enaStrobe(p_lcd);
+    putMap(p_lcd, data << 4);
+  }
+  else
+  {
+    putNibble(p_lcd, data >> 4);
+    enaStrobe(p_lcd);
+    putNibble(p_lcd, data);
+  }
+
+  enaStrobe(p_lcd);
+}
+
+//private command, DDRAM address of a cell on screen
+uint8_t cellAddr(struct s_lcd *p_lcd, uint8_t row, uint8_t col)
+{
+  uint8_t split = p_lcd->geometry.split;
+
+  //second half of a split row is in the second DDRAM line
+  if(split && (col >= split)) col += 0x40 - split;
+
+  return p_lcd->geometry.rowAddr[row & (LCD_GEOMETRY_ROWS - 1)] + col;
+}
+
+//read back and repair a budgeted slice of the display, picks up where the last call stopped
+uint8_t scrubLCD(struct s_lcd *p_lcd, uint16_t budgetUs)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t repairs = 0;
+  uint8_t addr = 0;
+  uint8_t addrValid = 0;
+  uint8_t wrapAddr = 0;
+  uint8_t entryModeSet = 0;
+  uint8_t phase = 0;
+  uint16_t reserve = 0;
+  uint16_t spent = 0;
+  uint16_t used = 0;
+
+  if(p_lcd == NULL) return 0;
+
+  //reading back needs R/W on a parallel bus no queue is using
+  if(!p_lcd->rw || !parallelBus(p_lcd) || (p_lcd->p_queue != NULL)) return 0;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_SCRUB);
+
+  addr = p_lcd->addr;
+  addrValid = p_lcd->addrValid;
+  wrapAddr = p_lcd->wrapAddr;
+  entryModeSet = p_lcd->entryModeSet;
+
+  //putting the cursor and entry mode back has to fit in the end
+  if(addrValid) reserve += p_lcd->timing.execUs + SCRUB_IO_US;
+
+  if(entryModeSet != (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT)) reserve += p_lcd->timing.execUs + SCRUB_IO_US;
+
+  budgetUs = ((budgetUs > reserve) ? (budgetUs - reserve) : 0);
+
+  for(;;)
+  {
+    phase = p_lcd->scrubPhase;
+
+    used = ((phase != SCRUB_CHECK) ? scrubReset(p_lcd, budgetUs - spent) : scrubRun(p_lcd, budgetUs - spent, &repairs));
+
+    spent += used;
+
+    //stop at the first step that doesn't fit
+    if(!used && (p_lcd->scrubPhase == phase)) break;
+  }
+
+  if(p_lcd->scrubPhase != SCRUB_CHECK)
+  {
+    //half way through the reset nothing else may go out, setup sends the entry mode
+    p_lcd->entryModeSet = entryModeSet;
+    p_lcd->addrValid = 0;
+  }
+  else if(spent)
+  {
+    restoreEntry(p_lcd, entryModeSet);
+
+    if(addrValid) gotoAddr(p_lcd, addr);
+
+    p_lcd->wrapAddr = wrapAddr;
+  }
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+
+  return repairs;
+}
+
+//private command, check bytes from s_lcd::scrubIndex on while they follow the address counter, a repair ends the run
+uint16_t scrubRun(struct s_lcd *p_lcd, uint16_t budget, uint8_t *p_repairs)
+{
+  uint16_t cmdUs = p_lcd->timing.execUs + SCRUB_IO_US;
+  uint16_t cells = 0;
+  uint16_t index = p_lcd->scrubIndex;
+  uint16_t spent = 0;
+  uint16_t repairUs = 2 * cmdUs;
+  uint8_t cmd = 0;
+  uint8_t addr = 0;
+  uint8_t data = 0;
+  uint8_t expect = 0;
+  uint8_t mask = 0;
+
+  if(p_lcd->p_shadow != NULL) cells = (uint16_t)p_lcd->rows * p_lcd->cols;
+
+  //past the line mode check, or the shadow went away, a new pass starts
+  if(index > (cells + 64)) index = 0;
+
+  //a repair may have to switch to the plain entry mode first
+  if(p_lcd->entryModeSet != (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT)) repairUs += cmdUs;
+
+  //cells still to be flushed aren't expected on the display yet
+  while((index < cells) && (p_lcd->p_dirty[index >> 3] & (1 << (index & 0x07)))) index++;
+
+  //CGRAM rows of slots without a glyph have nothing to compare with
+  while((index >= cells) && (index < (cells + 64)) && (p_lcd->p_glyphs[(index - cells) >> 3] == NULL))
+  {
+    index += 8 - ((index - cells) & 0x07);
+  }
+
+  p_lcd->scrubIndex = index;
+
+  if(index == (cells + 64))
+  {
+    //address, busy poll and data read, busy poll and address read, the display control
+    if(budget < (4 * cmdUs)) return 0;
+
+    //reading the last byte of the first line takes the address counter to the second line in 2 line mode only
+    lcdWrite(p_lcd, (LCD_SETDDRAMADDR | 0x27), INS_REG);
+    waitReady(p_lcd, DATA_REG);
+    readByte(p_lcd, DATA_REG);
+    waitReady(p_lcd, INS_REG);
+    addr = readByte(p_lcd, INS_REG);
+
+    //display on and the cursor can't be read back, send them again
+    lcdWrite(p_lcd, p_lcd->displaySetting, INS_REG);
+
+    p_lcd->scrubIndex = 0;
+
+    if(!p_lcd->busyCheck || (addr != 0x40)) scrubLost(p_lcd);
+
+    return 4 * cmdUs;
+  }
+
+  //address, busy poll and address read, the first byte and its repair
+  if(budget < ((3 * cmdUs) + repairUs)) return 0;
+
+  cmd = scrubCmd(p_lcd, index, cells);
+  mask = ((index < cells) ? 0xFF : 0x1F);
+
+  lcdWrite(p_lcd, cmd, INS_REG);
+  waitReady(p_lcd, INS_REG);
+  addr = readByte(p_lcd, INS_REG);
+  spent = 2 * cmdUs;
+
+  //a controller out of its bus mode hands back some other address, if the busy flag works at all
+  if(!p_lcd->busyCheck || (addr != (cmd & ((index < cells) ? ~LCD_SETDDRAMADDR : ~LCD_SETCGRAMADDR))))
+  {
+    scrubLost(p_lcd);
+    return spent;
+  }
+
+  for(;;)
+  {
+    //the last read may still be loading the next byte
+    waitReady(p_lcd, DATA_REG);
+    data = readByte(p_lcd, DATA_REG);
+    spent += cmdUs;
+
+    expect = ((index < cells) ? p_lcd->p_shadow[index] : pgm_read_byte(p_lcd->p_glyphs[(index - cells) >> 3] + ((index - cells) & 0x07)));
+
+    if((data ^ expect) & mask)
+    {
+      //entry mode is put back by scrubLCD
+      plainEntry(p_lcd);
+      lcdWrite(p_lcd, scrubCmd(p_lcd, index, cells), INS_REG);
+      lcdWrite(p_lcd, expect, DATA_REG);
+      spent += repairUs;
+      p_lcd->scrubRepairs++;
+      (*p_repairs)++;
+      p_lcd->scrubIndex = index + 1;
+
+      return spent;
+    }
+
+    index++;
+    p_lcd->scrubIndex = index;
+
+    if((spent + cmdUs + repairUs) > budget) break;
+
+    //the next cell has to be where the read left the address counter
+    if(index < cells)
+    {
+      if(p_lcd->p_dirty[index >> 3] & (1 << (index & 0x07))) break;
+
+      if(scrubCmd(p_lcd, index, cells) != (LCD_SETDDRAMADDR | p_lcd->addr)) break;
+    }
+    else if(!(p_lcd->entryModeSet & LCD_ENTRYLEFT) || !((index - cells) & 0x07) || (index > (cells + 63)))
+    {
+      break;
+    }
+  }
+
+  return spent;
+}
+
+//private command, one step of the reset sequence, what the last step owes is waited out of the budget first
+uint16_t scrubReset(struct s_lcd *p_lcd, uint16_t budget)
+{
+  uint16_t spent = 0;
+  uint16_t stepUs = ((p_lcd->scrubPhase == SCRUB_SETUP) ? 5 : 1) * (p_lcd->timing.execUs + SCRUB_IO_US);
+  uint16_t wait = 0;
+
+  if(p_lcd->scrubWait)
+  {
+    spent = ((p_lcd->scrubWait < budget) ? p_lcd->scrubWait : budget);
+    p_lcd->scrubWait -= spent;
+
+    for(wait = spent; wait > 0; wait--) _delay_us(1);
+
+    STAT_DELAY(p_lcd, spent);
+
+    if(p_lcd->scrubWait) return spent;
+  }
+
+  if(p_lcd->scrubPhase == SCRUB_HOME)
+  {
+    //the scrub finds what the controller lost from here on
+    p_lcd->scrubPhase = SCRUB_CHECK;
+    return spent;
+  }
+
+  if((budget - spent) < stepUs) return spent;
+
+  if(p_lcd->scrubPhase < SCRUB_SETUP)
+  {
+    //0x3 on D7 to D4 three times gets any controller into 8 bit mode, waits as in the datasheet
+    resetNibble(p_lcd, 0x30);
+    p_lcd->scrubWait = ((p_lcd->scrubPhase == SCRUB_RESET) ? 5000 : ((p_lcd->scrubPhase == (SCRUB_RESET + 1)) ? 150 : 0));
+    p_lcd->scrubPhase++;
+
+    return spent + stepUs;
+  }
+
+  if(!(p_lcd->functionSet & LCD_8BITMODE)) resetNibble(p_lcd, 0x20);
+
+  lcdWrite(p_lcd, p_lcd->functionSet, INS_REG);
+  lcdWrite(p_lcd, p_lcd->displaySetting, INS_REG);
+  lcdWrite(p_lcd, p_lcd->entryModeSet, INS_REG);
+  //home takes the display shift back to 0, its wait is owed to the next call if need be
+  p_lcd->busyCheck = 1;
+  lcdWrite(p_lcd, LCD_RETURNHOME, INS_REG | LONG_EXEC);
+  p_lcd->scrubWait = p_lcd->timing.longUs;
+  p_lcd->scrubPhase = SCRUB_HOME;
+  p_lcd->scrubIndex = 0;
+
+  //a flush puts the screen back in one go, the scrub covers what it doesn't
+  invalidateShadowLCD(p_lcd);
+
+  return spent + stepUs;
+}
+
+//private command, set address instruction of a scrub index, shadow cells then CGRAM bytes
+uint8_t scrubCmd(struct s_lcd *p_lcd, uint16_t index, uint16_t cells)
+{
+  if(index >= cells) return (LCD_SETCGRAMADDR | (index - cells));
+
+  return (LCD_SETDDRAMADDR | cellAddr(p_lcd, index / p_lcd->cols, index % p_lcd->cols));
+}
+
+//private command, controller lost its bus or line mode, nothing it says counts until the reset sequence is through
+void scrubLost(struct s_lcd *p_lcd)
+{
+  p_lcd->busyCheck = 0;
+  p_lcd->scrubPhase = SCRUB_RESET;
+  p_lcd->scrubWait = 0;
+  p_lcd->scrubRestarts++;
+}
+
+//private command, latch D7 to D4 of value as an instruction whatever bus mode the controller is in
+void resetNibble(struct s_lcd *p_lcd, uint8_t value)
+{
+  setRegSel(p_lcd, INS_REG);
+
+  if(p_lcd->p_map != NULL)
+  {
+    putMap(p_lcd, value);
+  }
+  else if(p_lcd->functionSet & LCD_8BITMODE)
+  {
+    LCD_PORT_WRITE(p_lcd->p_dataPort, value);
+  }
+  else
+  {
+    putNibble(p_lcd, value >> 4);
+  }
+
+  enaPulse(p_lcd);
+}
+
+//start a marquee, the display shift only carries it where DDRAM is left over off screen
+void startMarqueeLCD(struct s_lcd *p_lcd, struct s_lcdMarquee *p_marquee, uint8_t row, uint8_t col, uint8_t width, char *message, uint8_t gap, uint8_t mode)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t entryModeSet = 0;
+  uint8_t offset = 0;
+  uint8_t cols = 0;
+  size_t length = 0;
+
+  if((p_lcd == NULL) || (p_marquee == NULL)) return;
+
+  p_marquee->p_text = NULL;
+
+  if(message == NULL) return;
+
+  cols = p_lcd->geometry.cols;
+
+  if((row >= p_lcd->geometry.rows) || (col >= cols)) return;
+
+  if(!width || (width > (cols - col))) width = cols - col;
+
+  //text and gap have to fit the 8 bit position, an empty round is one space
+  length = strlen(message);
+
+  if((length + gap) > 255) length = 255 - gap;
+
+  if((length + gap) == 0) gap = 1;
+
+  //the shift moves whole DDRAM lines, so one row per line, all of it, with cells left off screen
+  if((mode == LCD_MARQUEE_SHIFT) && (col == 0) && (width == cols) && (cols < 40) && (p_lcd->geometry.rows <= 2) && !p_lcd->geometry.split && (p_lcd->functionSet & LCD_2LINE))
+  {
+    p_marquee->mode = LCD_MARQUEE_SHIFT;
+  }
+  else
+  {
+    p_marquee->mode = LCD_MARQUEE_ROW;
+  }
+
+  p_marquee->p_text = message;
+  p_marquee->length = (uint8_t)length;
+  p_marquee->period = (uint8_t)(length + gap);
+  p_marquee->row = row;
+  p_marquee->col = col;
+  p_marquee->width = width;
+  p_marquee->pos = 0;
+  p_marquee->shift = p_lcd->viewShift;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_WIDGET);
+
+  entryModeSet = plainEntry(p_lcd);
+
+  //a shift marquee also fills the cell that comes on screen with the next step
+  for(offset = 0; offset < width; offset++)
+  {
+    marqueeCell(p_lcd, p_marquee, offset);
+  }
+
+  if(p_marquee->mode == LCD_MARQUEE_SHIFT) marqueeCell(p_lcd, p_marquee, width);
+
+  restoreEntry(p_lcd, entryModeSet);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//one character to the left, a shift command and one cell or only the cells that change
+void stepMarqueeLCD(struct s_lcd *p_lcd, struct s_lcdMarquee *p_marquee)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t entryModeSet = 0;
+  uint8_t offset = 0;
+  uint8_t next = 0;
+  uint8_t pos = 0;
+
+  if((p_lcd == NULL) || (p_marquee == NULL)) return;
+
+  if(p_marquee->p_text == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_WIDGET);
+
+  entryModeSet = plainEntry(p_lcd);
+
+  pos = p_marquee->pos;
+  p_marquee->pos = (((pos + 1) < p_marquee->period) ? pos + 1 : 0);
+
+  if(p_marquee->mode == LCD_MARQUEE_SHIFT)
+  {
+    next = viewStep(p_marquee->shift, 1);
+
+    //the view is still where this marquee left it, a marquee on the other line may have moved it on already
+    if(p_lcd->viewShift == p_marquee->shift) lcdWrite(p_lcd, (LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVELEFT), INS_REG);
+
+    if(p_lcd->viewShift == next)
+    {
+      //everything on screen was filled in before, only the cell for the next step is missing
+      p_marquee->shift = next;
+      marqueeCell(p_lcd, p_marquee, p_marquee->width);
+    }
+    else
+    {
+      //the view was moved behind its back (clear, home, scroll), fill the line for where it is
+      p_marquee->shift = p_lcd->viewShift;
+
+      for(offset = 0; offset <= p_marquee->width; offset++)
+      {
+        marqueeCell(p_lcd, p_marquee, offset);
+      }
+    }
+  }
+  else
+  {
+    for(offset = 0; offset < p_marquee->width; offset++)
+    {
+      //the cell showed the character one to the right of it before this step
+      if(marqueeChar(p_marquee, (uint16_t)p_marquee->pos + offset) == marqueeChar(p_marquee, (uint16_t)pos + offset)) continue;
+
+      marqueeCell(p_lcd, p_marquee, offset);
+    }
+  }
+
+  restoreEntry(p_lcd, entryModeSet);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//start a bar graph with nothing filled
+void startBarLCD(struct s_lcd *p_lcd, struct s_lcdBar *p_bar, uint8_t row, uint8_t col, uint8_t length, uint8_t direction)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t entryModeSet = 0;
+  uint8_t index = 0;
+  uint8_t unit = 0;
+
+  if((p_lcd == NULL) || (p_bar == NULL)) return;
+
+  unit = ((direction == LCD_BAR_VERTICAL) ? 8 : 5);
+
+  //the level has to fit 8 bits
+  if(length > (255 / unit)) length = 255 / unit;
+
+  p_bar->row = row;
+  p_bar->col = col;
+  p_bar->length = length;
+  p_bar->direction = direction;
+  p_bar->level = 0;
+  p_bar->slot = 0;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_WIDGET);
+
+  entryModeSet = plainEntry(p_lcd);
+
+  for(index = 0; index < length; index++)
+  {
+    if(direction == LCD_BAR_VERTICAL)
+    {
+      widgetCell(p_lcd, row - index, col, ' ');
+    }
+    else
+    {
+      widgetCell(p_lcd, row, col + index, ' ');
+    }
+  }
+
+  restoreEntry(p_lcd, entryModeSet);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//new bar level, only cells whose pixel count changes are written
+void setBarLCD(struct s_lcd *p_lcd, struct s_lcdBar *p_bar, uint8_t level)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t entryModeSet = 0;
+  uint8_t index = 0;
+  uint8_t pixels = 0;
+  uint8_t unit = 0;
+  uint8_t stale = BAR_NONE;
+
+  if((p_lcd == NULL) || (p_bar == NULL)) return;
+
+  unit = ((p_bar->direction == LCD_BAR_VERTICAL) ? 8 : 5);
+
+  if(level > ((uint16_t)p_bar->length * unit)) level = p_bar->length * unit;
+
+  //the partial cell is rewritten when another glyphLCD user took its slot
+  pixels = p_bar->level % unit;
+
+  if(pixels && (p_lcd->p_glyphs[p_bar->slot] != barGlyph(p_bar->direction, pixels))) stale = p_bar->level / unit;
+
+  if((level == p_bar->level) && (stale == BAR_NONE)) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_WIDGET);
+
+  entryModeSet = plainEntry(p_lcd);
+
+  for(index = 0; index < p_bar->length; index++)
+  {
+    pixels = barPixels(level, index, unit);
+
+    if((pixels == barPixels(p_bar->level, index, unit)) && (index != stale)) continue;
+
+    if(p_bar->direction == LCD_BAR_VERTICAL)
+    {
+      widgetCell(p_lcd, p_bar->row - index, p_bar->col, barChar(p_lcd, p_bar, pixels));
+    }
+    else
+    {
+      widgetCell(p_lcd, p_bar->row, p_bar->col + index, barChar(p_lcd, p_bar, pixels));
+    }
+  }
+
+  p_bar->level = level;
+
+  restoreEntry(p_lcd, entryModeSet);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//start a big number with every digit blank
+void startBigLCD(struct s_lcd *p_lcd, struct s_lcdBig *p_big, const struct s_lcdBigFont *p_font, uint8_t row, uint8_t col, uint8_t digits)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t entryModeSet = 0;
+  uint8_t index = 0;
+  uint8_t cell = 0;
+  uint8_t cols = 0;
+  uint8_t rows = 0;
+
+  if((p_lcd == NULL) || (p_big == NULL)) return;
+
+  p_big->p_font = NULL;
+
+  if(p_font == NULL) return;
+
+  if(digits > LCD_BIG_DIGITS) digits = LCD_BIG_DIGITS;
+
+  p_big->p_font = p_font;
+  p_big->row = row;
+  p_big->col = col;
+  p_big->digits = digits;
+
+  cols = pgm_read_byte(&p_font->cols);
+  rows = pgm_read_byte(&p_font->rows);
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_WIDGET);
+
+  entryModeSet = plainEntry(p_lcd);
+
+  for(index = 0; index < digits; index++)
+  {
+    p_big->shown[index] = BIG_NONE;
+
+    //blank the digit and the column after it, except after the last one
+    for(cell = 0; cell < ((cols + 1) * rows); cell++)
+    {
+      if(((cell % (cols + 1)) == cols) && ((index + 1) == digits)) continue;
+
+      widgetCell(p_lcd, row + (cell / (cols + 1)), col + (index * (cols + 1)) + (cell % (cols + 1)), ' ');
+    }
+  }
+
+  restoreEntry(p_lcd, entryModeSet);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//right aligned number in big digits, only digits that change are redrawn
+void printBigLCD(struct s_lcd *p_lcd, struct s_lcdBig *p_big, uint32_t number, uint8_t flags)
+{
+  uint8_t tmpSREG = 0;
+  uint8_t entryModeSet = 0;
+  uint8_t index = 0;
+  uint8_t digit = 0;
+  uint8_t moved = 0;
+
+  if((p_lcd == NULL) || (p_big == NULL)) return;
+
+  if(p_big->p_font == NULL) return;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_WIDGET);
+
+  entryModeSet = plainEntry(p_lcd);
+
+  //other glyphLCD users may have evicted the glyphs on screen since the last call
+  moved = bigRefresh(p_lcd, p_big);
+
+  for(index = p_big->digits; index > 0; index--)
+  {
+    digit = (uint8_t)(number % 10);
+
+    //the last digit always shows, leading zeros only when asked for
+    if(!number && (index != p_big->digits) && !(flags & LCD_FMT_ZERO)) digit = BIG_NONE;
+
+    number /= 10;
+
+    if((digit != p_big->shown[index - 1]) || (bigGlyphs(p_big->p_font, digit) & moved))
+    {
+      bigDigit(p_lcd, p_big, index - 1, digit, moved);
+    }
+  }
+
+  restoreEntry(p_lcd, entryModeSet);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+}
+
+//private command, character of the text round at index, the gap is spaces
+uint8_t marqueeChar(struct s_lcdMarquee *p_marquee, uint16_t index)
+{
+  index %= p_marquee->period;
+
+  return ((index < p_marquee->length) ? (uint8_t)p_marquee->p_text[index] : ' ');
+}
+
+//private command, write the character offset cells into the window, past the window for a shift marquee
+void marqueeCell(struct s_lcd *p_lcd, struct s_lcdMarquee *p_marquee, uint8_t offset)
+{
+  uint8_t addr = 0;
+
+  //window cells follow the view round the 40 byte DDRAM line
+  if(p_marquee->mode == LCD_MARQUEE_SHIFT)
+  {
+    addr = p_lcd->geometry.rowAddr[p_marquee->row] + ((p_marquee->shift + offset) % 40);
+  }
+  else
+  {
+    addr = cellAddr(p_lcd, p_marquee->row, p_marquee->col + offset);
+  }
+
+  gotoAddr(p_lcd, addr);
+
+  lcdWrite(p_lcd, marqueeChar(p_marquee, (uint16_t)p_marquee->pos + offset), DATA_REG);
+}
+
+//private command, write a widget cell, cells off the screen are skipped
+void widgetCell(struct s_lcd *p_lcd, uint8_t row, uint8_t col, uint8_t data)
+{
+  if((row >= p_lcd->geometry.rows) || (col >= p_lcd->geometry.cols)) return;
+
+  gotoAddr(p_lcd, cellAddr(p_lcd, row, col));
+
+  lcdWrite(p_lcd, data, DATA_REG);
+}
+
+//private command, new line of a window, scrolls at the bottom if allowed
+void windowLine(struct s_lcd *p_lcd, struct s_lcdWindow *p_window)
+{
+  p_window->cursorCol = 0;
+
+  if((p_window->cursorRow + 1) < p_window->rows)
+  {
+    p_window->cursorRow++;
+  }
+  else if((p_window->flags & LCD_WIN_SCROLL) && p_window->rows)
+  {
+    scrollWindowLCD(p_lcd, p_window);
+    p_window->cursorRow = p_window->rows - 1;
+  }
+  else
+  {
+    //below the window, everything up to a clear or cursor move is cut off
+    p_window->cursorRow = p_window->rows;
+  }
+}
+
+//private command, pixels of a bar level that fall into cell index
+uint8_t barPixels(uint8_t level, uint8_t index, uint8_t unit)
+{
+  uint16_t start = (uint16_t)index * unit;
+
+  if(level <= start) return 0;
+
+  return (((level - start) >= unit) ? unit : (uint8_t)(level - start));
+}
+
+//private command, bitmap of a partial bar cell
+const uint8_t *barGlyph(uint8_t direction, uint8_t pixels)
+{
+  return ((direction == LCD_BAR_VERTICAL) ? g_barUp[pixels - 1] : g_barAcross[pixels - 1]);
+}
+
+//private command, character for a bar cell, partial cells come from the glyph cache
+uint8_t barChar(struct s_lcd *p_lcd, struct s_lcdBar *p_bar, uint8_t pixels)
+{
+  if(!pixels) return ' ';
+
+  if(pixels >= ((p_bar->direction == LCD_BAR_VERTICAL) ? 8 : 5)) return BIG_FULL;
+
+  //remembered so setBarLCD can tell when another glyphLCD user took the slot
+  p_bar->slot = glyphLCD(p_lcd, barGlyph(p_bar->direction, pixels));
+
+  return p_bar->slot;
+}
+
+//private command, cell code of a digit, a blank digit is all blank cells
+uint8_t bigCode(const struct s_lcdBigFont *p_font, uint8_t digit, uint8_t cell)
+{
+  if(digit > 9) return BIG_BLANK;
+
+  return pgm_read_byte(&p_font->cells[digit][cell]);
+}
+
+//private command, mask of the font glyphs a digit is drawn with
+uint8_t bigGlyphs(const struct s_lcdBigFont *p_font, uint8_t digit)
+{
+  uint8_t cells = pgm_read_byte(&p_font->cols) * pgm_read_byte(&p_font->rows);
+  uint8_t cell = 0;
+  uint8_t code = 0;
+  uint8_t mask = 0;
+
+  for(cell = 0; cell < cells; cell++)
+  {
+    code = bigCode(p_font, digit, cell);
+
+    if(code < LCD_GLYPH_SLOTS) mask |= (uint8_t)(1 << code);
+  }
+
+  return mask;
+}
+
+//private command, bring the glyphs of the digits on screen to the front of the cache, mask of those now in another slot
+uint8_t bigRefresh(struct s_lcd *p_lcd, struct s_lcdBig *p_big)
+{
+  const struct s_lcdBigFont *p_font = p_big->p_font;
+  uint8_t index = 0;
+  uint8_t glyph = 0;
+  uint8_t slot = 0;
+  uint8_t used = 0;
+  uint8_t moved = 0;
+
+  for(index = 0; index < p_big->digits; index++)
+  {
+    used |= bigGlyphs(p_font, p_big->shown[index]);
+  }
+
+  for(glyph = 0; glyph < LCD_GLYPH_SLOTS; glyph++)
+  {
+    if(!(used & (1 << glyph))) continue;
+
+    //reloaded if evicted, the slot it comes back in may differ from the one the cells show
+    slot = glyphLCD(p_lcd, p_font->glyph[glyph]);
+
+    if(slot != p_big->slots[glyph]) moved |= (uint8_t)(1 << glyph);
+
+    p_big->slots[glyph] = slot;
+  }
+
+  return moved;
+}
+
+//private command, rewrite the cells of a big digit that differ from the digit on screen or show a moved glyph
+void bigDigit(struct s_lcd *p_lcd, struct s_lcdBig *p_big, uint8_t index, uint8_t digit, uint8_t moved)
+{
+  const struct s_lcdBigFont *p_font = p_big->p_font;
+  uint8_t cols = pgm_read_byte(&p_font->cols);
+  uint8_t rows = pgm_read_byte(&p_font->rows);
+  uint8_t cell = 0;
+  uint8_t code = 0;
+
+  for(cell = 0; cell < (cols * rows); cell++)
+  {
+    code = bigCode(p_font, digit, cell);
+
+    if(code == bigCode(p_font, p_big->shown[index], cell))
+    {
+      if((code >= LCD_GLYPH_SLOTS) || !(moved & (1 << code))) continue;
+    }
+
+    //glyphs go into CGRAM on first use, the cells are written with the slot they got
+    if(code < LCD_GLYPH_SLOTS)
+    {
+      p_big->slots[code] = glyphLCD(p_lcd, p_font->glyph[code]);
+      code = p_big->slots[code];
+    }
+
+    widgetCell(p_lcd, p_big->row + (cell / cols), p_big->col + (index * (cols + 1)) + (cell % cols), code);
+  }
+
+  p_big->shown[index] = digit;
+}
+
+//attach ring buffer, writes are redirected to the queue until detached
+void attachQueueLCD(struct s_lcd *p_lcd, uint16_t *p_buffer, uint8_t size, uint8_t policy)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  //stays a real critical section in every mode, the tick interrupt must never see half of it
+
+  //detach, anything queued still has to reach the display
+  if(p_lcd->p_queue != NULL)
+  {
+    waitQueueLCD(p_lcd);
+
+    tmpSREG = SREG;
+    cli();
+
+    p_lcd->write = p_lcd->busWrite;
+    p_lcd->p_queue = NULL;
+
+    SREG = tmpSREG;
+
+    //direct writes don't know when the last queued byte went out
+    _delay_us(LCD_QUEUE_TICK_US);
+    STAT_DELAY(p_lcd, LCD_QUEUE_TICK_US);
+  }
+
+  if(p_buffer == NULL) return;
+
+  //size must be a power of 2 so indexes wrap with a mask
+  if((size < 2) || (size > 128) || (size & (size - 1))) return;
+
+  tmpSREG = SREG;
   cli();
 
-  p_lcd->entryModeSet |= LCD_ENTRYLEFT;
-  p_lcd->write(p_lcd, p_lcd->entryModeSet, INS_REG);
+  p_lcd->queueMask = size - 1;
+  p_lcd->queueHead = 0;
+  p_lcd->queueTail = 0;
+  p_lcd->queuePolicy = policy;
+  p_lcd->queueDrops = 0;
+  //a direct write may have just gone out, give it a tick to settle
+  p_lcd->queueWait = 1;
+  p_lcd->queuePhase = 0;
+  p_lcd->queuePolled = 0;
+  p_lcd->busWrite = p_lcd->write;
+  p_lcd->write = write_queue;
+  p_lcd->p_queue = p_buffer;
+
+  SREG = tmpSREG;
+}
+
+//one bus step per call, meant to run from a timer compare interrupt
+void tickQueueLCD(struct s_lcd *p_lcd)
+{
+  uint16_t wait = 0;
+
+  if(p_lcd == NULL) return;
+
+  if(p_lcd->p_queue == NULL) return;
+
+  //display still executing the last command
+  if(p_lcd->queueWait)
+  {
+    p_lcd->queueWait--;
+    return;
+  }
+
+  if(p_lcd->queueHead == p_lcd->queueTail) return;
+
+  wait = queueStep(p_lcd);
+
+  //the next tick is a tick away already, only clear and home wait longer
+  if(wait > LCD_QUEUE_TICK_US) p_lcd->queueWait = (wait + LCD_QUEUE_TICK_US - 1) / LCD_QUEUE_TICK_US;
+}
+
+//one bus step per call once the last one has settled, polled from the main loop
+uint8_t serviceLCD(struct s_lcd *p_lcd, uint16_t now)
+{
+  if(p_lcd == NULL) return 0;
+
+  if(p_lcd->p_queue == NULL) return 0;
+
+  //first call starts the clock, a direct write may have just gone out
+  if(!p_lcd->queuePolled)
+  {
+    //waitQueueLCD can't count on an interrupt to drain the queue any more
+    p_lcd->queuePolled = 1;
+    p_lcd->serviceStart = now;
+    p_lcd->serviceWait = p_lcd->timing.execUs;
+  }
+
+  if(p_lcd->queueHead == p_lcd->queueTail) return 0;
+
+  //elapsed time instead of a deadline, a late call is never mistaken for an early one
+  if((uint16_t)(now - p_lcd->serviceStart) < p_lcd->serviceWait) return queueDepthLCD(p_lcd);
+
+  p_lcd->serviceStart = now;
+  p_lcd->serviceWait = queueStep(p_lcd);
+  //a synchronous drain by waitQueueLCD has to respect the wait as well
+  p_lcd->queueWait = (p_lcd->serviceWait + LCD_QUEUE_TICK_US - 1) / LCD_QUEUE_TICK_US;
+
+  return queueDepthLCD(p_lcd);
+}
+
+//private command, send the next nibble or byte of the queue, returns the microseconds the display needs before the next step
+uint16_t queueStep(struct s_lcd *p_lcd)
+{
+  uint16_t entry = 0;
+
+  entry = p_lcd->p_queue[p_lcd->queueTail];
+
+  STAT_CALL(p_lcd, LCD_STAT_QUEUE);
+
+  if(p_lcd->busWrite == write_4bit)
+  {
+    //top nibble on this tick, bottom nibble on the next
+    if(!p_lcd->queuePhase)
+    {
+      setRegSel(p_lcd, entry >> 8);
+      putNibble(p_lcd, (uint8_t)entry >> 4);
+      enaStrobe(p_lcd);
+      p_lcd->queuePhase = 1;
+      return 0;
+    }
+
+    putNibble(p_lcd, (uint8_t)entry);
+    enaStrobe(p_lcd);
+    p_lcd->queuePhase = 0;
+  }
+  else if(p_lcd->busWrite == write_8bit)
+  {
+    setRegSel(p_lcd, entry >> 8);
+    LCD_PORT_WRITE(p_lcd->p_dataPort, (uint8_t)entry);
+    enaStrobe(p_lcd);
+  }
+  else if(p_lcd->busWrite == write_4bit_map)
+  {
+    //top nibble on this tick, bottom nibble on the next
+    if(!p_lcd->queuePhase)
+    {
+      setRegSel(p_lcd, entry >> 8);
+      putMap(p_lcd, (uint8_t)entry & 0xF0);
+      enaStrobe(p_lcd);
+      p_lcd->queuePhase = 1;
+      return 0;
+    }
+
+    putMap(p_lcd, (uint8_t)entry << 4);
+    enaStrobe(p_lcd);
+    p_lcd->queuePhase = 0;
+  }
+  else if(p_lcd->busWrite == write_8bit_map)
+  {
+    setRegSel(p_lcd, entry >> 8);
+    putMap(p_lcd, (uint8_t)entry);
+    enaStrobe(p_lcd);
+  }
+#ifdef HITACHI_LCD_STATIC
+  else if(p_lcd->busWrite == write_static)
+  {
+#if LCD_STATIC_MODE
+    staticRegSel(entry >> 8);
+    LCD_PORT_WRITE(&LCD_STATIC_DATA_PORT, (uint8_t)entry);
+    staticStrobe(p_lcd);
+#else
+    //top nibble on this tick, bottom nibble on the next
+    if(!p_lcd->queuePhase)
+    {
+      staticRegSel(entry >> 8);
+      staticNibble((uint8_t)entry >> 4);
+      staticStrobe(p_lcd);
+      p_lcd->queuePhase = 1;
+      return 0;
+    }
+
+    staticNibble((uint8_t)entry);
+    staticStrobe(p_lcd);
+    p_lcd->queuePhase = 0;
+#endif
+  }
+#endif
+  else
+  {
+    //unknown bus, let it do the full write, a step has settled since the last one and the long wait is ours
+    p_lcd->spiSettle = 0;
+    p_lcd->busWrite(p_lcd, (uint8_t)entry, (entry >> 8) & ~LONG_EXEC);
+    syncLCD(p_lcd);
+  }
+
+  p_lcd->queueTail = (p_lcd->queueTail + 1) & p_lcd->queueMask;
+
+  STAT_BYTE(p_lcd, entry >> 8);
+
+  //clear and home need about 2 ms before the next byte
+  return (((entry >> 8) & LONG_EXEC) ? p_lcd->timing.longUs : p_lcd->timing.execUs);
+}
+
+//number of entries still waiting to be sent
+uint8_t queueDepthLCD(struct s_lcd *p_lcd)
+{
+  if(p_lcd == NULL) return 0;
+
+  if(p_lcd->p_queue == NULL) return 0;
+
+  return (p_lcd->queueHead - p_lcd->queueTail) & p_lcd->queueMask;
+}
+
+//block until everything queued has been sent
+void waitQueueLCD(struct s_lcd *p_lcd)
+{
+  if(p_lcd == NULL) return;
+
+  if(p_lcd->p_queue == NULL) return;
+
+  while(queueDepthLCD(p_lcd) || p_lcd->queueWait)
+  {
+    //nobody else will tick the queue with interrupts off or when it is polled, do it here
+    if(!(SREG & (1 << SREG_I)) || p_lcd->queuePolled)
+    {
+      tickQueueLCD(p_lcd);
+      _delay_us(LCD_QUEUE_TICK_US);
+      STAT_DELAY(p_lcd, LCD_QUEUE_TICK_US);
+    }
+  }
+}
+
+#ifdef HITACHI_LCD_STATS
+//copy the counters, the tick interrupt may be counting so always a real critical section
+void snapshotStatsLCD(struct s_lcd *p_lcd, struct s_lcdStats *p_stats)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  if(p_stats == NULL) return;
+
+  tmpSREG = SREG;
+  cli();
+
+  *p_stats = p_lcd->stats;
+
+  SREG = tmpSREG;
+}
+
+//zero the counters
+void resetStatsLCD(struct s_lcd *p_lcd)
+{
+  uint8_t tmpSREG = 0;
+
+  if(p_lcd == NULL) return;
+
+  tmpSREG = SREG;
+  cli();
+
+  STAT_RESET(p_lcd);
+
+  SREG = tmpSREG;
+}
+
+//private command, book a wait, interrupts being off when it ends means they were off all along
+void statDelay(struct s_lcd *p_lcd, uint16_t us)
+{
+  uint32_t window = 0;
+
+  p_lcd->stats.delayUs += us;
+
+  if(SREG & (1 << SREG_I))
+  {
+    g_irqOffUs = 0;
+    return;
+  }
+
+  window = (uint32_t)g_irqOffUs + us;
+  g_irqOffUs = (window > 0xFFFF ? 0xFFFF : window);
+
+  if(g_irqOffUs > p_lcd->stats.irqOffMaxUs) p_lcd->stats.irqOffMaxUs = g_irqOffUs;
+}
+
+//private command, LCD_IRQ_SAVE hook, interrupts were on before the call so the window starts over
+void statIrqSave(uint8_t sreg)
+{
+  if(sreg & (1 << SREG_I)) g_irqOffUs = 0;
+}
+#endif
+
+//private command used to queue data instead of writing it to data lines
+void write_queue(void *p_lcd, uint8_t data, int regSel)
+{
+  struct s_lcd *pc_lcd = NULL;
+  uint8_t next = 0;
+
+  if(p_lcd == NULL) return;
+
+  pc_lcd = (struct s_lcd *)p_lcd;
+
+  next = (pc_lcd->queueHead + 1) & pc_lcd->queueMask;
+
+  //full, public calls normally run with interrupts off so the ISR can't make room for us
+  while(next == pc_lcd->queueTail)
+  {
+    if(pc_lcd->queuePolicy != LCD_QUEUE_BLOCK)
+    {
+      pc_lcd->queueDrops++;
+      //the display won't be where we think it is
+      pc_lcd->addrValid = 0;
+      return;
+    }
+
+    //low latency mode leaves interrupts on, the tick interrupt makes room then
+    if((SREG & (1 << SREG_I)) && !pc_lcd->queuePolled) continue;
+
+    tickQueueLCD(pc_lcd);
+    _delay_us(LCD_QUEUE_TICK_US);
+    STAT_DELAY(pc_lcd, LCD_QUEUE_TICK_US);
+  }
+
+  pc_lcd->p_queue[pc_lcd->queueHead] = ((uint16_t)regSel << 8) | data;
+  pc_lcd->queueHead = next;
+}
+
+//private command, every write goes through here so the DDRAM address counter is mirrored
+void lcdWrite(struct s_lcd *p_lcd, uint8_t data, int regSel)
+{
+#ifdef HITACHI_LCD_STATIC
+  //direct call so the constant pin writes can be inlined
+  if(p_lcd->write == write_static)
+  {
+    write_static(p_lcd, data, regSel);
+  }
+  else
+  {
+    p_lcd->write(p_lcd, data, regSel);
+  }
+#else
+  p_lcd->write(p_lcd, data, regSel);
+#endif
+
+  //queued bytes are counted when they go out
+  if(p_lcd->p_queue == NULL) STAT_BYTE(p_lcd, regSel);
+
+  trackAddr(p_lcd, data, regSel);
+}
+
+//private command, mirror what a write does to the DDRAM address counter
+void trackAddr(struct s_lcd *p_lcd, uint8_t data, int regSel)
+{
+
+  if(regSel & DATA_REG)
+  {
+    p_lcd->addr = nextAddr(p_lcd, p_lcd->addr, p_lcd->entryModeSet & LCD_ENTRYLEFT);
+    p_lcd->wrapAddr = NO_WRAP;
+
+    //autoscroll moves the view along with the cursor
+    if(p_lcd->entryModeSet & LCD_ENTRYSHIFTINCREMENT) p_lcd->viewShift = viewStep(p_lcd->viewShift, p_lcd->entryModeSet & LCD_ENTRYLEFT);
+  }
+  else if(data & LCD_SETDDRAMADDR)
+  {
+    p_lcd->addr = data & ~LCD_SETDDRAMADDR;
+    p_lcd->addrValid = 1;
+    p_lcd->wrapAddr = NO_WRAP;
+  }
+  else if(data & LCD_SETCGRAMADDR)
+  {
+    //address counter now points into CGRAM
+    p_lcd->addrValid = 0;
+    p_lcd->wrapAddr = NO_WRAP;
+  }
+  else if((data & (LCD_FUNCTIONSET | LCD_CURSORSHIFT | LCD_DISPLAYMOVE)) == LCD_CURSORSHIFT)
+  {
+    p_lcd->addr = nextAddr(p_lcd, p_lcd->addr, data & LCD_MOVERIGHT);
+    p_lcd->wrapAddr = NO_WRAP;
+  }
+  else if((data & (LCD_FUNCTIONSET | LCD_CURSORSHIFT | LCD_DISPLAYMOVE)) == (LCD_CURSORSHIFT | LCD_DISPLAYMOVE))
+  {
+    //display shift, the address counter stays
+    p_lcd->viewShift = viewStep(p_lcd->viewShift, !(data & LCD_MOVERIGHT));
+  }
+  else if((data == LCD_CLEARDISPLAY) || ((data & ~0x01) == LCD_RETURNHOME))
+  {
+    p_lcd->wrapAddr = NO_WRAP;
+
+    //clear also forces increment in the entry mode
+    if(data == LCD_CLEARDISPLAY) p_lcd->entryModeSet |= LCD_ENTRYLEFT;
+
+    p_lcd->addr = 0;
+    p_lcd->addrValid = 1;
+    p_lcd->viewShift = 0;
+  }
+}
+
+//private command, set the DDRAM address unless the address counter is already there
+void gotoAddr(struct s_lcd *p_lcd, uint8_t addr)
+{
+  if(p_lcd->addrValid && (p_lcd->addr == addr)) return;
+
+  lcdWrite(p_lcd, (LCD_SETDDRAMADDR | addr), INS_REG);
+}
+
+//private command, write a character, the one after the last column of a row goes to the next row
+void putChar(struct s_lcd *p_lcd, uint8_t data)
+{
+  uint8_t wrapAddr = NO_WRAP;
+
+  //one set DDRAM address instead of running into DDRAM that is not on screen
+  if(p_lcd->wrapAddr != NO_WRAP) gotoAddr(p_lcd, p_lcd->wrapAddr);
+
+  //only plain left to right text wraps, anything else is up to the caller
+  if(p_lcd->addrValid && (p_lcd->entryModeSet == (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT)))
+  {
+    wrapAddr = wrapTarget(p_lcd, p_lcd->addr);
+  }
+
+  lcdWrite(p_lcd, data, DATA_REG);
+
+  //owed until the next character, so text ending on the last column costs nothing
+  p_lcd->wrapAddr = wrapAddr;
+}
+
+//private command, row addr is on, rows if it is not on screen
+uint8_t addrRow(struct s_lcd *p_lcd, uint8_t addr)
+{
+  uint8_t row = 0;
+  uint8_t cols = p_lcd->geometry.cols;
+  uint8_t split = p_lcd->geometry.split;
+
+  for(row = 0; row < p_lcd->geometry.rows; row++)
+  {
+    if((uint8_t)(addr - cellAddr(p_lcd, row, 0)) < (split ? split : cols)) return row;
+
+    if(split && ((uint8_t)(addr - cellAddr(p_lcd, row, split)) < (cols - split))) return row;
+  }
+
+  return row;
+}
+
+//private command, display shift after one step of the view to the left or right
+uint8_t viewStep(uint8_t shift, uint8_t left)
+{
+  if(left) return ((shift < 39) ? shift + 1 : 0);
+
+  return (shift ? shift - 1 : 39);
+}
+
+//private command, plain increment entry mode for address bursts, returns the one to put back
+uint8_t plainEntry(struct s_lcd *p_lcd)
+{
+  uint8_t entryModeSet = p_lcd->entryModeSet;
+
+  //bursts rely on the address counter incrementing without shifting the display
+  if(entryModeSet != (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT))
+  {
+    p_lcd->entryModeSet = (LCD_ENTRYMODESET | LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT);
+    lcdWrite(p_lcd, p_lcd->entryModeSet, INS_REG);
+  }
+
+  return entryModeSet;
+}
+
+//private command, put back the entry mode plainEntry replaced
+void restoreEntry(struct s_lcd *p_lcd, uint8_t entryModeSet)
+{
+  if(entryModeSet == p_lcd->entryModeSet) return;
+
+  p_lcd->entryModeSet = entryModeSet;
+  lcdWrite(p_lcd, p_lcd->entryModeSet, INS_REG);
+}
+
+//private command, stream character, \n starts the next row, \r the current row and \f clears
+void putStream(struct s_lcd *p_lcd, char data)
+{
+  uint8_t row = 0;
+  uint8_t rows = p_lcd->geometry.rows;
+
+  switch(data)
+  {
+    case '\f':
+      lcdWrite(p_lcd, LCD_CLEARDISPLAY, INS_REG | LONG_EXEC);
+      break;
+    case '\n':
+    case '\r':
+      if(p_lcd->wrapAddr != NO_WRAP)
+      {
+        row = addrRow(p_lcd, p_lcd->wrapAddr);
+
+        //wrap to the start of a row is owed, the cursor is still on the row before
+        if((row < rows) && (cellAddr(p_lcd, row, 0) == p_lcd->wrapAddr)) row = (row ? row : rows) - 1;
+      }
+      else if(p_lcd->addrValid)
+      {
+        row = addrRow(p_lcd, p_lcd->addr);
+      }
+
+      //unknown or off screen addresses count as the first row
+      if(row >= rows) row = 0;
+
+      if(data == '\n') row = ((row + 1) < rows ? row + 1 : 0);
+
+      gotoAddr(p_lcd, cellAddr(p_lcd, row, 0));
+      p_lcd->wrapAddr = NO_WRAP;
+      break;
+    default:
+      putChar(p_lcd, (uint8_t)data);
+      break;
+  }
+}
+
+#ifdef HITACHI_LCD_HOST
+//private command, fopencookie write, a whole fwrite goes out as one call
+ssize_t streamWrite(void *p_cookie, const char *p_data, size_t size)
+{
+  uint8_t tmpSREG = 0;
+  size_t index = 0;
+  struct s_lcd *p_lcd = (struct s_lcd *)p_cookie;
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  for(index = 0; index < size; index++)
+  {
+    putStream(p_lcd, p_data[index]);
+  }
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+
+  return size;
+}
+#else
+//private command, avr-libc stream put, one call per character
+int streamPut(char data, FILE *p_stream)
+{
+  uint8_t tmpSREG = 0;
+  struct s_lcd *p_lcd = (struct s_lcd *)fdev_get_udata(p_stream);
+
+  LCD_IRQ_SAVE(tmpSREG);
+  STAT_CALL(p_lcd, LCD_STAT_PRINT);
+
+  putStream(p_lcd, data);
+
+  syncLCD(p_lcd);
+
+  LCD_IRQ_RESTORE(tmpSREG);
+
+  return 0;
+}
+#endif
+
+//private command, where text continues after addr if it is the last cell of a line, NO_WRAP otherwise
+uint8_t wrapTarget(struct s_lcd *p_lcd, uint8_t addr)
+{
+  uint8_t row = 0;
+  uint8_t rows = p_lcd->geometry.rows;
+  uint8_t split = p_lcd->geometry.split;
+
+  for(row = 0; row < rows; row++)
+  {
+    if(split && (addr == cellAddr(p_lcd, row, split - 1))) return cellAddr(p_lcd, row, split);
+
+    if(addr == cellAddr(p_lcd, row, p_lcd->geometry.cols - 1)) return cellAddr(p_lcd, ((row + 1) < rows ? row + 1 : 0), 0);
+  }
+
+  return NO_WRAP;
+}
+
+//private command, address counter after one step, 2 line mode wraps 0x27 <-> 0x40 and 0x67 <-> 0x00
+uint8_t nextAddr(struct s_lcd *p_lcd, uint8_t addr, uint8_t increment)
+{
+  if(!(p_lcd->functionSet & LCD_2LINE))
+  {
+    return (increment ? ((addr >= 0x4F) ? 0x00 : addr + 1) : ((addr == 0x00) ? 0x4F : addr - 1));
+  }
+
+  if(increment)
+  {
+    if(addr == 0x27) return 0x40;
+
+    if(addr == 0x67) return 0x00;
+
+    return addr + 1;
+  }
+
+  if(addr == 0x00) return 0x67;
+
+  if(addr == 0x40) return 0x27;
+
+  return addr - 1;
+}
+
+//private command, sign, integer digits, optional fraction digits and padding out to width
+void putNumber(struct s_lcd *p_lcd, char sign, uint32_t number, uint8_t base, uint8_t precision, uint32_t frac, uint8_t width, uint8_t flags)
+{
+  uint8_t length = 0;
+  uint8_t count = 0;
+
+  if((base < 2) || (base > 36)) return;
+
+  count = countDigits(number, base);
+  length = count + (sign ? 1 : 0) + (precision ? precision + 1 : 0);
+
+  //spaces go before the sign, zeros after it
+  if(!(flags & (LCD_FMT_LEFT | LCD_FMT_ZERO)))
+  {
+    for(; length < width; length++) putChar(p_lcd, ' ');
+  }
+
+  if(sign) putChar(p_lcd, sign);
+
+  if((flags & (LCD_FMT_LEFT | LCD_FMT_ZERO)) == LCD_FMT_ZERO)
+  {
+    for(; length < width; length++) putChar(p_lcd, '0');
+  }
+
+  putDigits(p_lcd, number, base, count, flags);
+
+  if(precision)
+  {
+    putChar(p_lcd, '.');
+    putDigits(p_lcd, frac, 10, precision, flags);
+  }
 
-  SREG = tmpSREG;
+  if(flags & LCD_FMT_LEFT)
+  {
+    for(; length < width; length++) putChar(p_lcd, ' ');
+  }
 }
 
-//set text to flow Right to Left
-void rightToLeftLCD(struct s_lcd *p_lcd)
+//private command, number of digits needed to show number in base
+uint8_t countDigits(uint32_t number, uint8_t base)
 {
-  uint8_t tmpSREG = 0;
+  uint8_t count = 1;
 
-  if(p_lcd == NULL) return;
+  if(base == 10)
+  {
+    while((count < 10) && (number >= pgm_read_dword(&g_pow10[count]))) count++;
 
-  tmpSREG = SREG;
-  cli();
+    return count;
+  }
 
-  p_lcd->entryModeSet &= ~LCD_ENTRYLEFT;
-  p_lcd->write(p_lcd, p_lcd->entryModeSet, INS_REG);
+  while(number >= base)
+  {
+    number /= base;
+    count++;
+  }
 
-  SREG = tmpSREG;
+  return count;
 }
 
-// This will 'right justify' text from the cursor
-void autoscrollOnLCD(struct s_lcd *p_lcd)
+//private command, write exactly count digits most significant first, no buffer needed
+void putDigits(struct s_lcd *p_lcd, uint32_t number, uint8_t base, uint8_t count, uint8_t flags)
 {
-  uint8_t tmpSREG = 0;
+  uint8_t digit = 0;
+  uint32_t divisor = 1;
+  uint32_t power = 0;
 
-  if(p_lcd == NULL) return;
+  //base 10 uses repeated subtraction of powers of 10, no 32 bit divides on the AVR
+  if(base == 10)
+  {
+    for(; count > 0; count--)
+    {
+      digit = '0';
 
-  tmpSREG = SREG;
-  cli();
+      if(count <= 10)
+      {
+        power = pgm_read_dword(&g_pow10[count - 1]);
 
-  p_lcd->entryModeSet |= LCD_ENTRYSHIFTINCREMENT;
-  p_lcd->write(p_lcd, p_lcd->entryModeSet, INS_REG);
+        while(number >= power)
+        {
+          number -= power;
+          digit++;
+        }
+      }
 
-  SREG = tmpSREG;
+      putChar(p_lcd, digit);
+    }
+
+    return;
+  }
+
+  //base 16 is just shifts
+  if(base == 16)
+  {
+    for(; count > 0; count--)
+    {
+      digit = (count > 8 ? 0 : (number >> ((count - 1) << 2)) & 0x0F);
+
+      putChar(p_lcd, (digit < 10 ? '0' + digit : ((flags & LCD_FMT_UPPER) ? 'A' : 'a') + digit - 10));
+    }
+
+    return;
+  }
+
+  for(digit = 1; digit < count; digit++) divisor *= base;
+
+  for(; count > 0; count--)
+  {
+    digit = number / divisor;
+    number %= divisor;
+    divisor /= base;
+
+    putChar(p_lcd, (digit < 10 ? '0' + digit : ((flags & LCD_FMT_UPPER) ? 'A' : 'a') + digit - 10));
+  }
 }
 
-// This will 'left justify' text from the cursor
-void autoscrollOffLCD(struct s_lcd *p_lcd)
+//private command used to write data to data lines
+void write_4bit(void *p_lcd, uint8_t data, int regSel)
 {
-  uint8_t tmpSREG = 0;
+  struct s_lcd *pc_lcd = NULL;
 
   if(p_lcd == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
-
-  p_lcd->entryModeSet &= ~LCD_ENTRYSHIFTINCREMENT;
-  p_lcd->write(p_lcd, p_lcd->entryModeSet, INS_REG);
+  pc_lcd = (struct s_lcd *)p_lcd;
 
-  SREG = tmpSREG;
+  //wait for the last command instead of sleeping after it
+  if(pc_lcd->busyCheck) waitReady(pc_lcd, regSel);
+  //instruction or data mode
+  setRegSel(pc_lcd, regSel);
+  //send out top nibble
+  putNibble(pc_lcd, data >> 4);
+  //latch data, nothing executes until the bottom nibble so no settle time
+  enaStrobe(pc_lcd);
+  //send out bottom nibble
+  putNibble(pc_lcd, data);
+  //latch data
+  enaLatch(pc_lcd);
+  //clear and home need far longer than the pulse settle time
+  if((regSel & LONG_EXEC) && !pc_lcd->busyCheck) waitLong(pc_lcd);
 }
 
-//allows a cursor to be set, row is defined and col is used as an offset.
-void setCursorLCD(struct s_lcd *p_lcd, uint8_t row, uint8_t col)
+//private command used to write data to data lines
+void write_8bit(void *p_lcd, uint8_t data, int regSel)
 {
-uint8_t tmpSREG = 0;
+  struct s_lcd *pc_lcd = NULL;
 
   if(p_lcd == NULL) return;
 
-  tmpSREG = SREG;
-  cli();
+  pc_lcd = (struct s_lcd *)p_lcd;
+
+  //wait for the last command instead of sleeping after it
+  if(pc_lcd->busyCheck) waitReady(pc_lcd, regSel);
+  //instruction or data mode
+  setRegSel(pc_lcd, regSel);
+  //send out full word
+  LCD_PORT_WRITE(pc_lcd->p_dataPort, data);
+  //latch data
+  enaLatch(pc_lcd);
+  //clear and home need far longer than the pulse settle time
+  if((regSel & LONG_EXEC) && !pc_lcd->busyCheck) waitLong(pc_lcd);
+}
+
+#ifdef HITACHI_LCD_STATIC
+//private command used to write data to the data lines from hitachiLcdConfig.h
+void write_static(void *p_lcd, uint8_t data, int regSel)
+{
+  struct s_lcd *pc_lcd = (struct s_lcd *)p_lcd;
+
+  //wait for the last command instead of sleeping after it
+  if(pc_lcd->busyCheck) waitReady(pc_lcd, regSel);
+  //instruction or data mode
+  staticRegSel(regSel);
+#if LCD_STATIC_MODE
+  //send out full word
+  LCD_PORT_WRITE(&LCD_STATIC_DATA_PORT, data);
+  staticStrobe(pc_lcd);
+#else
+  //send out top nibble, nothing executes until the bottom nibble so no settle time
+  staticNibble(data >> 4);
+  staticStrobe(pc_lcd);
+  //send out bottom nibble
+  staticNibble(data);
+  staticStrobe(pc_lcd);
+#endif
+  //commands need > 37us to settle, clear and home far longer
+  if(!pc_lcd->busyCheck) waitExec(pc_lcd);
+  if((regSel & LONG_EXEC) && !pc_lcd->busyCheck) waitLong(pc_lcd);
+}
 
-  switch(row)
+//private command used to set register select, single bit so sbi/cbi
+void staticRegSel(int regSel)
+{
+  if(regSel & DATA_REG)
   {
-    //line 2
-    case 1:
-      p_lcd->write(p_lcd, (LCD_SETDDRAMADDR | (col + 0x40)), INS_REG);
-      break;
-    //line 3
-    case 2:
-      p_lcd->write(p_lcd, (LCD_SETDDRAMADDR | (col + 0x14)), INS_REG);
-      break;
-    //line 4
-    case 3:
-      p_lcd->write(p_lcd, (LCD_SETDDRAMADDR | (col + 0x00)), INS_REG);
-      break;
-    //line 1
-    case 0:
-    default:
-      p_lcd->write(p_lcd, (LCD_SETDDRAMADDR | (col + 0x00)), INS_REG);
-      break;
+    LCD_PORT_OR(&LCD_STATIC_CTRL_PORT, (1 << LCD_STATIC_RS));
+  }
+  else
+  {
+    LCD_PORT_AND(&LCD_STATIC_CTRL_PORT, ~(1 << LCD_STATIC_RS));
   }
+}
 
-  SREG = tmpSREG;
+//private command used to place the low nibble on data lines 0 to 3 in one port write
+void staticNibble(uint8_t nibble)
+{
+  LCD_ATOMIC(LCD_PORT_WRITE(&LCD_STATIC_DATA_PORT, (LCD_PORT_READ(&LCD_STATIC_DATA_PORT) & 0xF0) | (nibble & 0x0F)));
 }
 
-//private command used to write data to data lines
-void write_4bit(void *p_lcd, uint8_t data, int regSel)
+//private command used to pulse enable, single bit so sbi/cbi
+void staticStrobe(struct s_lcd *p_lcd)
+{
+  STAT_STROBE(p_lcd);
+  //make sure enable is low
+  LCD_PORT_AND(&LCD_STATIC_CTRL_PORT, ~(1 << LCD_STATIC_ENA));
+  _delay_loop_1(p_lcd->pulseLoops);
+  //enable set to high
+  LCD_PORT_OR(&LCD_STATIC_CTRL_PORT, (1 << LCD_STATIC_ENA));
+  //enable pulse width from the timing profile
+  _delay_loop_1(p_lcd->pulseLoops);
+  //enable set to low
+  LCD_PORT_AND(&LCD_STATIC_CTRL_PORT, ~(1 << LCD_STATIC_ENA));
+}
+#endif
+
+//private command, bus of a handle whose init failed, drops the byte
+void write_none(void *p_lcd, uint8_t data, int regSel)
+{
+  (void)p_lcd;
+  (void)data;
+  (void)regSel;
+}
+
+//private command used to write data to mapped data lines
+void write_4bit_map(void *p_lcd, uint8_t data, int regSel)
 {
   struct s_lcd *pc_lcd = NULL;
 
@@ -496,49 +3678,281 @@ void write_4bit(void *p_lcd, uint8_t data, int regSel)
 
   pc_lcd = (struct s_lcd *)p_lcd;
 
+  //wait for the last command instead of sleeping after it
+  if(pc_lcd->busyCheck) waitReady(pc_lcd, regSel);
   //instruction or data mode
-  if (regSel)
+  setRegSel(pc_lcd, regSel);
+  //send out top nibble on D7 to D4
+  putMap(pc_lcd, data & 0xF0);
+  //latch data, nothing executes until the bottom nibble so no settle time
+  enaStrobe(pc_lcd);
+  //send out bottom nibble on D7 to D4
+  putMap(pc_lcd, data << 4);
+  //latch data
+  enaLatch(pc_lcd);
+  //clear and home need far longer than the pulse settle time
+  if((regSel & LONG_EXEC) && !pc_lcd->busyCheck) waitLong(pc_lcd);
+}
+
+//private command used to write data to mapped data lines
+void write_8bit_map(void *p_lcd, uint8_t data, int regSel)
+{
+  struct s_lcd *pc_lcd = NULL;
+
+  if(p_lcd == NULL) return;
+
+  pc_lcd = (struct s_lcd *)p_lcd;
+
+  //wait for the last command instead of sleeping after it
+  if(pc_lcd->busyCheck) waitReady(pc_lcd, regSel);
+  //instruction or data mode
+  setRegSel(pc_lcd, regSel);
+  //send out full word
+  putMap(pc_lcd, data);
+  //latch data
+  enaLatch(pc_lcd);
+  //clear and home need far longer than the pulse settle time
+  if((regSel & LONG_EXEC) && !pc_lcd->busyCheck) waitLong(pc_lcd);
+}
+
+//private command, put D7 to D0 on the mapped lines with one write per port
+void putMap(struct s_lcd *p_lcd, uint8_t lines)
+{
+  struct s_lcdMap *p_map = p_lcd->p_map;
+  uint8_t index = 0;
+
+  for(index = 0; index < p_map->ports; index++)
   {
-    *(pc_lcd->p_ctrlPort) |= pc_lcd->rs;
+    LCD_ATOMIC(LCD_PORT_WRITE(p_map->p_port[index], (LCD_PORT_READ(p_map->p_port[index]) & ~(p_map->mask[index])) | p_map->lut[index][0][lines & 0x0F] | p_map->lut[index][1][lines >> 4]));
   }
-  else
+}
+
+//private command, gather D7 to D0 from the mapped lines, one PIN read per port
+uint8_t readMap(struct s_lcd *p_lcd)
+{
+  struct s_lcdMap *p_map = p_lcd->p_map;
+  uint8_t pins[LCD_MAP_PORTS];
+  uint8_t index = 0;
+  uint8_t line = 0;
+  uint8_t data = 0;
+
+  for(index = 0; index < p_map->ports; index++)
   {
-    *(pc_lcd->p_ctrlPort) &= ~(pc_lcd->rs);
+    pins[index] = LCD_PORT_READ(p_map->p_port[index] - 2);
   }
-  //send out top nibble
-  *(pc_lcd->p_dataPort) |= data >> 4;
-  *(pc_lcd->p_dataPort) &= ((MASK_8BIT_FF << 4) | (data >> 4));
-  //latch data
-  enaPulse(pc_lcd);
-  //send out bottom nibble
-  *(pc_lcd->p_dataPort) |= (~(MASK_8BIT_FF << 4) & data);
-  *(pc_lcd->p_dataPort) &= ((MASK_8BIT_FF << 4) | data);
-  //latch data
-  enaPulse(pc_lcd);
+
+  for(line = ((p_lcd->functionSet & LCD_8BITMODE) ? 0 : 4); line < 8; line++)
+  {
+    index = (p_map->p_data[line] == p_map->p_port[0] ? 0 : 1);
+
+    if(pins[index] & (1 << p_map->dataBit[line])) data |= (1 << line);
+  }
+
+  return data;
 }
 
-//private command used to write data to data lines
-void write_8bit(void *p_lcd, uint8_t data, int regSel)
+//private command used to write data through a PCF8574 backpack, bytes are batched until syncLCD
+void write_twi(void *p_lcd, uint8_t data, int regSel)
 {
   struct s_lcd *pc_lcd = NULL;
+  uint8_t bits = 0;
+  uint8_t pad = 0;
 
   if(p_lcd == NULL) return;
 
   pc_lcd = (struct s_lcd *)p_lcd;
 
-  //instruction or data mode
-  if (regSel)
+  bits = pc_lcd->backlight | ((regSel & DATA_REG) ? LCD_PCF_RS : 0);
+
+  //E stays low while the last byte finishes on a fast bus
+  for(pad = pc_lcd->twiPad; pad > 0; pad--) batchPut(pc_lcd, bits);
+
+  //top nibble then bottom nibble on P4 to P7
+  twiNibble(pc_lcd, bits | (data & 0xF0));
+  twiNibble(pc_lcd, bits | (data << 4));
+
+  //clear and home need far longer than the I2C byte time
+  if(regSel & LONG_EXEC)
+  {
+    syncLCD(pc_lcd);
+    waitLong(pc_lcd);
+  }
+}
+
+//private command, E high with the nibble then E low, the display latches on the falling edge
+void twiNibble(struct s_lcd *p_lcd, uint8_t bits)
+{
+  STAT_STROBE(p_lcd);
+  batchPut(p_lcd, bits | LCD_PCF_EN);
+  batchPut(p_lcd, bits);
+}
+
+//private command, add one expander byte, send the batch when full
+void batchPut(struct s_lcd *p_lcd, uint8_t bits)
+{
+  if(p_lcd->batchLen >= p_lcd->batchSize) syncLCD(p_lcd);
+
+  p_lcd->p_batch[p_lcd->batchLen++] = bits;
+}
+
+//private command, send batched bus bytes, called at the end of every call that writes
+void syncLCD(struct s_lcd *p_lcd)
+{
+  if(!p_lcd->batchLen) return;
+
+  p_lcd->twiSend(p_lcd->twiAddr, p_lcd->p_batch, p_lcd->batchLen);
+  p_lcd->batchLen = 0;
+}
+
+//private command used to write data through 74HC595 shift registers
+void write_spi(void *p_lcd, uint8_t data, int regSel)
+{
+  struct s_lcd *pc_lcd = NULL;
+  uint8_t bits = 0;
+
+  if(p_lcd == NULL) return;
+
+  pc_lcd = (struct s_lcd *)p_lcd;
+
+  bits = pc_lcd->backlight | ((regSel & DATA_REG) ? LCD_PCF_RS : 0);
+
+  //the E pulse of the byte or the top nibble, spiPulse counts its own
+  STAT_STROBE(pc_lcd);
+
+  if(pc_lcd->functionSet & LCD_8BITMODE)
   {
-    *(pc_lcd->p_ctrlPort) |= pc_lcd->rs;
+    //E high with the byte, then shift E low while the last byte is still executing
+    spiUpdate(pc_lcd, data, bits | LCD_PCF_EN);
+    spiRclk(pc_lcd);
+    spiUpdate(pc_lcd, data, bits);
+    //the 4 SPI bytes of this call count towards the settle time, time before the call isn't tracked
+    if(pc_lcd->spiSettle)
+    {
+      _delay_loop_2(pc_lcd->execLoops > 4 * SPI_BYTE_LOOPS ? pc_lcd->execLoops - 4 * SPI_BYTE_LOOPS : 1);
+      STAT_DELAY(pc_lcd, pc_lcd->timing.execUs);
+    }
+    spiRclk(pc_lcd);
   }
   else
   {
-    *(pc_lcd->p_ctrlPort) &= ~(pc_lcd->rs);
+    spiUpdate(pc_lcd, data, bits | LCD_PCF_EN);
+    spiRclk(pc_lcd);
+    spiUpdate(pc_lcd, data, bits);
+    //the 2 SPI bytes of this call count towards the settle time, time before the call isn't tracked
+    if(pc_lcd->spiSettle)
+    {
+      _delay_loop_2(pc_lcd->execLoops > 2 * SPI_BYTE_LOOPS ? pc_lcd->execLoops - 2 * SPI_BYTE_LOOPS : 1);
+      STAT_DELAY(pc_lcd, pc_lcd->timing.execUs);
+    }
+    spiRclk(pc_lcd);
+    //bottom nibble, nothing executes between the nibbles
+    spiPulse(pc_lcd, data << 4, bits);
   }
-  //send out full word
-  *(pc_lcd->p_dataPort) = data;
-  //latch data
-  enaPulse(pc_lcd);
+
+  //leave the settle time to the next write, clear and home need far longer
+  pc_lcd->spiSettle = 1;
+
+  if(regSel & LONG_EXEC)
+  {
+    waitLong(pc_lcd);
+    pc_lcd->spiSettle = 0;
+  }
+}
+
+//private command, shift in D7 to D0 and the control bits, outputs change at spiRclk
+void spiUpdate(struct s_lcd *p_lcd, uint8_t lines, uint8_t bits)
+{
+  //data register is at the far end of the chain so it goes first
+  if(p_lcd->functionSet & LCD_8BITMODE)
+  {
+    LCD_SPI_START(lines);
+    LCD_SPI_WAIT();
+    LCD_SPI_START(bits);
+  }
+  else
+  {
+    LCD_SPI_START(bits | (lines & 0xF0));
+  }
+
+  LCD_SPI_WAIT();
+}
+
+//private command, copy the shift registers to their outputs
+void spiRclk(struct s_lcd *p_lcd)
+{
+  LCD_PORT_OR(p_lcd->p_ctrlPort, p_lcd->latch);
+  LCD_PORT_AND(p_lcd->p_ctrlPort, ~(p_lcd->latch));
+}
+
+//private command, E high then low with the same lines, no settle time
+void spiPulse(struct s_lcd *p_lcd, uint8_t lines, uint8_t bits)
+{
+  STAT_STROBE(p_lcd);
+  spiUpdate(p_lcd, lines, bits | LCD_PCF_EN);
+  spiRclk(p_lcd);
+  spiUpdate(p_lcd, lines, bits);
+  spiRclk(p_lcd);
+}
+
+#if !defined(HITACHI_LCD_HOST) && defined(TWCR)
+//TWI master at frequency, no prescaler
+void twiInitLCD(uint32_t frequency)
+{
+  TWSR = 0;
+  TWBR = (uint8_t)(((F_CPU / frequency) - 16) / 2);
+  TWCR = (1 << TWEN);
+}
+
+//polled TWI write, stops early on a NACK
+void twiSendLCD(uint8_t address, uint8_t *p_data, uint8_t length)
+{
+  uint8_t index = 0;
+
+  //START
+  TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
+  while(!(TWCR & (1 << TWINT)));
+
+  //SLA+W
+  TWDR = (address << 1);
+  TWCR = (1 << TWINT) | (1 << TWEN);
+  while(!(TWCR & (1 << TWINT)));
+
+  //0x18 SLA+W ACK, 0x28 data ACK
+  if((TWSR & 0xF8) == 0x18)
+  {
+    for(index = 0; index < length; index++)
+    {
+      TWDR = p_data[index];
+      TWCR = (1 << TWINT) | (1 << TWEN);
+      while(!(TWCR & (1 << TWINT)));
+
+      if((TWSR & 0xF8) != 0x28) break;
+    }
+  }
+
+  //STOP
+  TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
+}
+#endif
+
+//private command used to set register select for instruction or data mode
+void setRegSel(struct s_lcd *p_lcd, int regSel)
+{
+  if (regSel & DATA_REG)
+  {
+    LCD_PORT_OR(p_lcd->p_ctrlPort, p_lcd->rs);
+  }
+  else
+  {
+    LCD_PORT_AND(p_lcd->p_ctrlPort, ~(p_lcd->rs));
+  }
+}
+
+//private command used to place the low nibble of data on data lines 0 to 3
+void putNibble(struct s_lcd *p_lcd, uint8_t nibble)
+{
+  LCD_PORT_OR(p_lcd->p_dataPort, (~(MASK_8BIT_FF << 4) & nibble));
+  LCD_PORT_AND(p_lcd->p_dataPort, ((MASK_8BIT_FF << 4) | nibble));
 }
 
 //routine to pulse enable pin to latch data
@@ -546,15 +3960,146 @@ void enaPulse(struct s_lcd *p_lcd)
 {
   if(p_lcd == NULL) return;
 
-  //make sure enable is low
-  *(p_lcd->p_ctrlPort) &= ~(p_lcd->ena);
+  enaStrobe(p_lcd);
+  //commands need > 37us to settle, the profile says how long exactly
+  waitExec(p_lcd);
+}
+
+//routine to latch data, the settle delay is skipped when the busy flag is polled
+void enaLatch(struct s_lcd *p_lcd)
+{
+  if(p_lcd->busyCheck)
+  {
+    enaStrobe(p_lcd);
+    return;
+  }
+
+  enaPulse(p_lcd);
+}
+
+//private command, wait out a command or data byte
+void waitExec(struct s_lcd *p_lcd)
+{
+  _delay_loop_2(p_lcd->execLoops);
+  STAT_DELAY(p_lcd, p_lcd->timing.execUs);
+}
+
+//private command, wait out clear or home
+void waitLong(struct s_lcd *p_lcd)
+{
+  _delay_loop_2(p_lcd->longLoops);
+  STAT_DELAY(p_lcd, p_lcd->timing.longUs);
+}
+
+//private command used to read the busy flag/address (INS_REG) or data at the address counter (DATA_REG)
+uint8_t readByte(struct s_lcd *p_lcd, int regSel)
+{
+  uint8_t data = 0;
+  uint8_t index = 0;
+  uint8_t mask = ((p_lcd->functionSet & LCD_8BITMODE) ? MASK_8BIT_FF : ~(MASK_8BIT_FF << 4));
+
+  //data lines to input without pull ups before the display drives them
+  if(p_lcd->p_map != NULL)
+  {
+    for(index = 0; index < p_lcd->p_map->ports; index++)
+    {
+      LCD_PORT_AND(p_lcd->p_map->p_port[index] - 1, ~(p_lcd->p_map->mask[index]));
+      LCD_PORT_AND(p_lcd->p_map->p_port[index], ~(p_lcd->p_map->mask[index]));
+    }
+  }
+  else
+  {
+    LCD_PORT_AND(p_lcd->p_dataPort - 1, ~mask);
+    LCD_PORT_AND(p_lcd->p_dataPort, ~mask);
+  }
+
+  setRegSel(p_lcd, regSel);
+  LCD_PORT_OR(p_lcd->p_ctrlPort, p_lcd->rw);
+
+  STAT_READ(p_lcd);
+  STAT_STROBE(p_lcd);
+
+  //data is valid < 360ns after enable goes high
+  LCD_PORT_OR(p_lcd->p_ctrlPort, p_lcd->ena);
   _delay_us(1);
+  data = ((p_lcd->p_map != NULL) ? readMap(p_lcd) : LCD_PORT_READ(p_lcd->p_dataPort - 2));
+  LCD_PORT_AND(p_lcd->p_ctrlPort, ~(p_lcd->ena));
+
+  //4 bit mode reads top nibble first, then the bottom nibble
+  if(!(p_lcd->functionSet & LCD_8BITMODE))
+  {
+    //mapped reads already come back on D7 to D4
+    data = ((p_lcd->p_map != NULL) ? (data & 0xF0) : (data << 4));
+    _delay_us(1);
+    STAT_STROBE(p_lcd);
+    LCD_PORT_OR(p_lcd->p_ctrlPort, p_lcd->ena);
+    _delay_us(1);
+    data |= ((p_lcd->p_map != NULL) ? (readMap(p_lcd) >> 4) : (LCD_PORT_READ(p_lcd->p_dataPort - 2) & mask));
+    LCD_PORT_AND(p_lcd->p_ctrlPort, ~(p_lcd->ena));
+  }
+
+  //back to write mode with data lines driven
+  LCD_PORT_AND(p_lcd->p_ctrlPort, ~(p_lcd->rw));
+
+  if(p_lcd->p_map != NULL)
+  {
+    for(index = 0; index < p_lcd->p_map->ports; index++)
+    {
+      LCD_PORT_OR(p_lcd->p_map->p_port[index] - 1, p_lcd->p_map->mask[index]);
+    }
+  }
+  else
+  {
+    LCD_PORT_OR(p_lcd->p_dataPort - 1, mask);
+  }
+
+  //data reads move the address counter like writes do
+  if(regSel & DATA_REG)
+  {
+    p_lcd->lastExec = DATA_REG;
+    p_lcd->addr = nextAddr(p_lcd, p_lcd->addr, p_lcd->entryModeSet & LCD_ENTRYLEFT);
+  }
+
+  return data;
+}
+
+//private command, poll busy flag until clear, gives up after the fixed delay worst case
+void waitReady(struct s_lcd *p_lcd, int regSel)
+{
+  uint16_t timeout = ((p_lcd->lastExec & LONG_EXEC) ? p_lcd->timing.longUs : p_lcd->timing.execUs);
+  uint8_t pollUs = ((p_lcd->functionSet & LCD_8BITMODE) ? BUSY_POLL_US : (BUSY_POLL_US + 2));
+
+  if(p_lcd->p_map != NULL) pollUs += BUSY_POLL_MAP_US;
+
+  p_lcd->lastExec = regSel;
+
+  //the timeout is spent in real time, each poll is a read and the 1us wait after it
+  while(readByte(p_lcd, INS_REG) & LCD_BUSYFLAG)
+  {
+    if(timeout < pollUs)
+    {
+      //R/W readback isn't working, fall back to fixed delays for good
+      p_lcd->busyCheck = 0;
+      return;
+    }
+
+    timeout -= pollUs;
+    _delay_us(1);
+    STAT_DELAY(p_lcd, 1);
+  }
+}
+
+//routine to pulse enable pin without waiting for the command to settle
+void enaStrobe(struct s_lcd *p_lcd)
+{
+  STAT_STROBE(p_lcd);
+  //make sure enable is low
+  LCD_PORT_AND(p_lcd->p_ctrlPort, ~(p_lcd->ena));
+  _delay_loop_1(p_lcd->pulseLoops);
   //enable set to high
-  *(p_lcd->p_ctrlPort) |= p_lcd->ena;
-  // enable pulse must be >450ns
-  _delay_us(1);
+  LCD_PORT_OR(p_lcd->p_ctrlPort, p_lcd->ena);
+  //enable pulse width from the timing profile
+  _delay_loop_1(p_lcd->pulseLoops);
   //enable set to low
-  *(p_lcd->p_ctrlPort) &= ~(p_lcd->ena);
-  // commands need > 37us to settle
-  _delay_us(50);
+  LCD_PORT_AND(p_lcd->p_ctrlPort, ~(p_lcd->ena));
 }
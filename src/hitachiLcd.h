@@ -36,6 +36,7 @@
 #define _LCD_H_
 
 #include <inttypes.h>
+#include <stdio.h>
 
 // LCD defines were imported from the Arduino LiquidCrystal.h, no need to reinvent the wheel.
 // commands
@@ -76,6 +77,9 @@
 #define LCD_5x10DOTS 0x04
 #define LCD_5x8DOTS 0x00
 
+//flag for busy flag/address counter read
+#define LCD_BUSYFLAG 0x80
+
 //RS and enable places in bit pattern
 #define RS 0x20
 #define ENABLE 0x10
@@ -83,6 +87,103 @@
 //setup stuffs
 #define INS_REG	 0
 #define DATA_REG 1
+//pass as rw pin when R/W is tied to ground
+#define LCD_NO_RW 0xFF
+//or'ed with INS_REG for commands that need the long execution time (clear/home)
+#define LONG_EXEC 0x02
+//init runs the full power on sequence and clears the screen
+#define LCD_INIT_COLD  0
+//init trusts the controller stayed powered and configured (soft reset), screen content is kept
+#define LCD_INIT_WARM  1
+//init reads the address counter back (needs R/W) and only goes warm if the controller answers and isn't busy in its power on reset
+#define LCD_INIT_PROBE 2
+
+//PCF8574 backpack outputs, P4 to P7 are D4 to D7. 74HC595 control register outputs Q0 to Q7 are the same.
+#define LCD_PCF_RS 0x01
+#define LCD_PCF_RW 0x02
+#define LCD_PCF_EN 0x04
+#define LCD_PCF_BL 0x08
+
+//number format flags, pad with zeros instead of spaces
+#define LCD_FMT_ZERO  0x01
+//number format flags, left align and pad on the right
+#define LCD_FMT_LEFT  0x02
+//number format flags, print + on positive numbers
+#define LCD_FMT_PLUS  0x04
+//number format flags, upper case digits above 9
+#define LCD_FMT_UPPER 0x08
+
+//screen program opcodes, bytes 0x20 and up are characters written as they are
+//end of the program
+#define LCD_SCR_END    0x00
+//move the cursor, followed by row and col
+#define LCD_SCR_CURSOR 0x01
+//glyph from the glyph table, followed by its index
+#define LCD_SCR_GLYPH  0x02
+//field placeholder, followed by field number and width
+#define LCD_SCR_FIELD  0x03
+//write the next byte as is, for codes below 0x20
+#define LCD_SCR_RAW    0x04
+//clear the screen
+#define LCD_SCR_CLEAR  0x05
+
+//screen program helpers, LCD_SCR_AT(1, 0), 'V', ':', LCD_SCR_FIELD_OF(0, 4), LCD_SCR_END
+#define LCD_SCR_AT(row, col)           LCD_SCR_CURSOR, (row), (col)
+#define LCD_SCR_GLYPH_OF(index)        LCD_SCR_GLYPH, (index)
+#define LCD_SCR_FIELD_OF(field, width) LCD_SCR_FIELD, (field), (width)
+
+//number of CGRAM glyphs in 5x8 mode
+#define LCD_GLYPH_SLOTS 8
+
+//async queue overflow policy, drop discards new bytes and counts them
+#define LCD_QUEUE_DROP  0
+//async queue overflow policy, block drains the oldest bytes synchronously until there is room
+#define LCD_QUEUE_BLOCK 1
+
+//period in microseconds that tickQueueLCD is called at, must cover the 37us settle time
+#ifndef LCD_QUEUE_TICK_US
+#define LCD_QUEUE_TICK_US 50
+#endif
+
+//most displays flushGroupLCD interleaves, more go in several groups
+#define LCD_GROUP_MAX 8
+
+//size in bytes of the dirty bitmap needed for a shadow buffer of rows * cols
+#define LCD_SHADOW_DIRTY_SIZE(rows, cols) ((((uint16_t)(rows) * (cols)) + 7) >> 3)
+
+//window flag, text reaching the right edge goes on in the next line instead of being cut off
+#define LCD_WIN_WRAP   0x01
+//window flag, a new line past the bottom moves the window contents up instead of being cut off
+#define LCD_WIN_SCROLL 0x02
+
+//marquee mode, rewrites the cells of its window that change each step
+#define LCD_MARQUEE_ROW   0
+//marquee mode, moves the whole display with the shift command and refills DDRAM off screen
+#define LCD_MARQUEE_SHIFT 1
+
+//bar graph grows to the right, 5 pixels a cell
+#define LCD_BAR_HORIZONTAL 0
+//bar graph grows up, 8 pixels a cell
+#define LCD_BAR_VERTICAL   1
+
+//most cells of one big digit (3x3)
+#define LCD_BIG_CELLS 9
+//most digits of one big number
+#define LCD_BIG_DIGITS 6
+
+//s_lcdStats::calls index per group of calls, HITACHI_LCD_STATS builds only
+#define LCD_STAT_INIT    0
+#define LCD_STAT_PRINT   1
+#define LCD_STAT_CURSOR  2
+#define LCD_STAT_CLEAR   3
+#define LCD_STAT_CONTROL 4
+#define LCD_STAT_GLYPH   5
+#define LCD_STAT_SCREEN  6
+#define LCD_STAT_FLUSH   7
+#define LCD_STAT_QUEUE   8
+#define LCD_STAT_WIDGET  9
+#define LCD_STAT_SCRUB   10
+#define LCD_STAT_APIS    11
 
 /***************************************************************************//**
  * @typedef write_callback
@@ -90,6 +191,388 @@
  ******************************************************************************/
 typedef void (*write_callback)(void *p_lcd, uint8_t, int);
 
+/***************************************************************************//**
+ * @typedef twi_callback
+ * @brief   I2C write transaction, START, address, length bytes, STOP
+ ******************************************************************************/
+typedef void (*twi_callback)(uint8_t address, uint8_t *p_data, uint8_t length);
+
+struct s_lcd;
+
+/***************************************************************************//**
+ * @typedef field_callback
+ * @brief   prints field of a screen program, width characters at the cursor
+ ******************************************************************************/
+typedef void (*field_callback)(struct s_lcd *p_lcd, uint8_t field, uint8_t width);
+
+//rows a geometry descriptor has start addresses for
+#define LCD_GEOMETRY_ROWS 4
+
+/**
+ * @struct s_lcdGeometry
+ * @brief Screen layout, where each row starts in DDRAM. Kept in flash
+ *        (PROGMEM), setGeometryLCD copies it into the LCD struct.
+ */
+struct s_lcdGeometry
+{
+  /**
+   * @var s_lcdGeometry::rows
+   * number of rows on screen
+   */
+  uint8_t rows;
+  /**
+   * @var s_lcdGeometry::cols
+   * number of columns on screen
+   */
+  uint8_t cols;
+  /**
+   * @var s_lcdGeometry::split
+   * column a row continues in the second DDRAM line at (16x1), 0 if none
+   */
+  uint8_t split;
+  /**
+   * @var s_lcdGeometry::rowAddr
+   * DDRAM address of the first cell of each row
+   */
+  uint8_t rowAddr[LCD_GEOMETRY_ROWS];
+};
+
+//geometry descriptors in flash for setGeometryLCD
+extern const struct s_lcdGeometry g_lcdGeometry16x1;
+extern const struct s_lcdGeometry g_lcdGeometry16x2;
+extern const struct s_lcdGeometry g_lcdGeometry20x2;
+extern const struct s_lcdGeometry g_lcdGeometry40x2;
+extern const struct s_lcdGeometry g_lcdGeometry16x4;
+extern const struct s_lcdGeometry g_lcdGeometry20x4;
+
+/**
+ * @struct s_lcdTiming
+ * @brief Controller timings. Kept in flash (PROGMEM), setTimingLCD copies
+ *        it into the LCD struct and works out delay loop counts for F_CPU.
+ */
+struct s_lcdTiming
+{
+  /**
+   * @var s_lcdTiming::execUs
+   * microseconds a command or data byte takes to execute (37us on a HD44780 at 270kHz)
+   */
+  uint16_t execUs;
+  /**
+   * @var s_lcdTiming::longUs
+   * microseconds clear and home take to execute (1.52ms on a HD44780 at 270kHz)
+   */
+  uint16_t longUs;
+  /**
+   * @var s_lcdTiming::pulseNs
+   * nanoseconds enable is held high and low (230ns on a 5V HD44780)
+   */
+  uint16_t pulseNs;
+};
+
+//timing profiles in flash for setTimingLCD
+extern const struct s_lcdTiming g_lcdTimingHD44780;
+extern const struct s_lcdTiming g_lcdTimingST7066;
+extern const struct s_lcdTiming g_lcdTiming3V;
+
+//data ports a pin map may spread the data lines over
+#define LCD_MAP_PORTS 2
+
+/**
+ * @struct s_lcdMap
+ * @brief Data line pin map, filled in by the caller and kept for the life of
+ *        the display. initLCD_map builds the lookup tables.
+ */
+struct s_lcdMap
+{
+  /**
+   * @var s_lcdMap::p_data
+   * port (PORT register) of each data line D0 to D7, only D4 to D7 in 4 bit mode
+   */
+  volatile uint8_t *p_data[8];
+  /**
+   * @var s_lcdMap::dataBit
+   * pin number of each data line on its port
+   */
+  uint8_t dataBit[8];
+  /**
+   * @var s_lcdMap::p_port
+   * distinct ports used by the data lines, built at init
+   */
+  volatile uint8_t *p_port[LCD_MAP_PORTS];
+  /**
+   * @var s_lcdMap::mask
+   * data line bits on each port, built at init
+   */
+  uint8_t mask[LCD_MAP_PORTS];
+  /**
+   * @var s_lcdMap::lut
+   * port bits for a nibble on the low (D0-D3) or high (D4-D7) lines, built at init
+   */
+  uint8_t lut[LCD_MAP_PORTS][2][16];
+  /**
+   * @var s_lcdMap::ports
+   * number of ports in p_port
+   */
+  uint8_t ports;
+};
+
+/**
+ * @struct s_lcdWindow
+ * @brief Rectangle of the shadow buffer with its own cursor, opened with
+ *        openWindowLCD and kept by the caller. Windows only write the
+ *        shadow, flushLCD sends what changed.
+ */
+struct s_lcdWindow
+{
+  /**
+   * @var s_lcdWindow::row
+   * top row of the window on screen
+   */
+  uint8_t row;
+  /**
+   * @var s_lcdWindow::col
+   * left column of the window on screen
+   */
+  uint8_t col;
+  /**
+   * @var s_lcdWindow::rows
+   * rows in the window
+   */
+  uint8_t rows;
+  /**
+   * @var s_lcdWindow::cols
+   * columns in the window
+   */
+  uint8_t cols;
+  /**
+   * @var s_lcdWindow::cursorRow
+   * row the next character goes to, rows once text ran off the bottom
+   */
+  uint8_t cursorRow;
+  /**
+   * @var s_lcdWindow::cursorCol
+   * column the next character goes to, cols once the line is full
+   */
+  uint8_t cursorCol;
+  /**
+   * @var s_lcdWindow::flags
+   * LCD_WIN_WRAP, LCD_WIN_SCROLL or'ed
+   */
+  uint8_t flags;
+};
+
+/**
+ * @struct s_lcdMarquee
+ * @brief Text scrolling through a window of one row, started with
+ *        startMarqueeLCD and kept by the caller while it runs.
+ */
+struct s_lcdMarquee
+{
+  /**
+   * @var s_lcdMarquee::p_text
+   * scrolled string, not copied, has to stay put while the marquee runs
+   */
+  const char *p_text;
+  /**
+   * @var s_lcdMarquee::length
+   * characters in p_text
+   */
+  uint8_t length;
+  /**
+   * @var s_lcdMarquee::period
+   * steps until the text comes round again, length plus the gap of spaces
+   */
+  uint8_t period;
+  /**
+   * @var s_lcdMarquee::row
+   * row of the window
+   */
+  uint8_t row;
+  /**
+   * @var s_lcdMarquee::col
+   * first column of the window
+   */
+  uint8_t col;
+  /**
+   * @var s_lcdMarquee::width
+   * columns in the window
+   */
+  uint8_t width;
+  /**
+   * @var s_lcdMarquee::mode
+   * LCD_MARQUEE_ROW or LCD_MARQUEE_SHIFT, the one actually used
+   */
+  uint8_t mode;
+  /**
+   * @var s_lcdMarquee::pos
+   * character of the text in the first column of the window
+   */
+  uint8_t pos;
+  /**
+   * @var s_lcdMarquee::shift
+   * display shift the DDRAM line was filled for (LCD_MARQUEE_SHIFT)
+   */
+  uint8_t shift;
+};
+
+/**
+ * @struct s_lcdBar
+ * @brief Bar graph, started with startBarLCD and kept by the caller. The
+ *        partial cell uses a CGRAM glyph from glyphLCD.
+ */
+struct s_lcdBar
+{
+  /**
+   * @var s_lcdBar::row
+   * row of the first cell, the bottom one of a vertical bar
+   */
+  uint8_t row;
+  /**
+   * @var s_lcdBar::col
+   * column of the first cell
+   */
+  uint8_t col;
+  /**
+   * @var s_lcdBar::length
+   * cells in the bar
+   */
+  uint8_t length;
+  /**
+   * @var s_lcdBar::direction
+   * LCD_BAR_HORIZONTAL or LCD_BAR_VERTICAL
+   */
+  uint8_t direction;
+  /**
+   * @var s_lcdBar::level
+   * pixels on screen now
+   */
+  uint8_t level;
+  /**
+   * @var s_lcdBar::slot
+   * CGRAM slot the partial cell was written with
+   */
+  uint8_t slot;
+};
+
+/**
+ * @struct s_lcdBigFont
+ * @brief Digits made of several cells. Kept in flash (PROGMEM), the glyphs
+ *        are loaded through glyphLCD when a digit needs them.
+ */
+struct s_lcdBigFont
+{
+  /**
+   * @var s_lcdBigFont::cols
+   * cells across one digit
+   */
+  uint8_t cols;
+  /**
+   * @var s_lcdBigFont::rows
+   * cells down one digit
+   */
+  uint8_t rows;
+  /**
+   * @var s_lcdBigFont::glyph
+   * 8 byte bitmaps the cells refer to
+   */
+  uint8_t glyph[LCD_GLYPH_SLOTS][8];
+  /**
+   * @var s_lcdBigFont::cells
+   * cells of 0 to 9 row by row, an index into glyph below LCD_GLYPH_SLOTS, a character code above
+   */
+  uint8_t cells[10][LCD_BIG_CELLS];
+};
+
+//big digit fonts in flash for startBigLCD, 2x2 takes all 8 CGRAM slots, 3x3 only 2
+extern const struct s_lcdBigFont g_lcdBigFont2x2;
+extern const struct s_lcdBigFont g_lcdBigFont3x3;
+
+/**
+ * @struct s_lcdBig
+ * @brief Number in big digits, started with startBigLCD and kept by the
+ *        caller.
+ */
+struct s_lcdBig
+{
+  /**
+   * @var s_lcdBig::p_font
+   * font in flash (PROGMEM)
+   */
+  const struct s_lcdBigFont *p_font;
+  /**
+   * @var s_lcdBig::row
+   * top row of the digits
+   */
+  uint8_t row;
+  /**
+   * @var s_lcdBig::col
+   * left column of the first digit, digits are one column apart
+   */
+  uint8_t col;
+  /**
+   * @var s_lcdBig::digits
+   * digits in the number, up to LCD_BIG_DIGITS
+   */
+  uint8_t digits;
+  /**
+   * @var s_lcdBig::shown
+   * digit on screen at each position, 10 for blank
+   */
+  uint8_t shown[LCD_BIG_DIGITS];
+  /**
+   * @var s_lcdBig::slots
+   * CGRAM slot the cells of each font glyph were written with
+   */
+  uint8_t slots[LCD_GLYPH_SLOTS];
+};
+
+#ifdef HITACHI_LCD_STATS
+/**
+ * @struct s_lcdStats
+ * @brief Driver cost counters of one display, kept while HITACHI_LCD_STATS
+ *        is defined. Init zeroes them.
+ */
+struct s_lcdStats
+{
+  /**
+   * @var s_lcdStats::dataBytes
+   * bytes written to DDRAM/CGRAM on the bus
+   */
+  uint32_t dataBytes;
+  /**
+   * @var s_lcdStats::insBytes
+   * instruction bytes written on the bus, init nibbles not included
+   */
+  uint32_t insBytes;
+  /**
+   * @var s_lcdStats::reads
+   * busy flag, address and data reads
+   */
+  uint32_t reads;
+  /**
+   * @var s_lcdStats::strobes
+   * enable pulses, reads and init nibbles included
+   */
+  uint32_t strobes;
+  /**
+   * @var s_lcdStats::delayUs
+   * microseconds spent waiting on the display (settle, clear/home, busy polls, full queue)
+   */
+  uint32_t delayUs;
+  /**
+   * @var s_lcdStats::irqOffMaxUs
+   * longest wait in one stretch with interrupts disabled, every call in the
+   * default build, only calls made with interrupts off in the low latency build
+   */
+  uint16_t irqOffMaxUs;
+  /**
+   * @var s_lcdStats::calls
+   * calls per LCD_STAT_* group, queue counts bus steps, glyph counts CGRAM uploads
+   */
+  uint32_t calls[LCD_STAT_APIS];
+};
+#endif
+
 /**
  * @struct s_lcd
  * @brief Struct for containing hitachi LCD instances
@@ -116,6 +599,26 @@ struct s_lcd
    * Bit used for enable on control port
    */
   uint8_t ena;
+  /**
+   * @var s_lcd::rw
+   * Bit used for read/write on control port, 0 if R/W is tied low
+   */
+  uint8_t rw;
+  /**
+   * @var s_lcd::busyCheck
+   * poll the busy flag instead of fixed delays (needs rw)
+   */
+  uint8_t busyCheck;
+  /**
+   * @var s_lcd::lastExec
+   * register select flags of the last write, picks the busy poll timeout
+   */
+  uint8_t lastExec;
+  /**
+   * @var s_lcd::warm
+   * init skipped the power on waits and kept the screen content
+   */
+  uint8_t warm;
   /**
    * @var s_lcd::displaySetting
    * Store display settings
@@ -156,44 +659,483 @@ struct s_lcd
    * function pointer for write method (8 vs 4 bit).
    */
   write_callback write;
+  /**
+   * @var s_lcd::addr
+   * mirror of the DDRAM address counter
+   */
+  uint8_t addr;
+  /**
+   * @var s_lcd::addrValid
+   * addr matches the display, cleared when the address is unknown (CGRAM access, dropped bytes)
+   */
+  uint8_t addrValid;
+  /**
+   * @var s_lcd::geometry
+   * screen layout used for cursor positions and line wrapping
+   */
+  struct s_lcdGeometry geometry;
+  /**
+   * @var s_lcd::wrapAddr
+   * address the next character goes to after the last column was written, 0xFF if none
+   */
+  uint8_t wrapAddr;
+  /**
+   * @var s_lcd::viewShift
+   * columns the display shift has moved the view left, 0 to 39
+   */
+  uint8_t viewShift;
+  /**
+   * @var s_lcd::timing
+   * controller timing profile
+   */
+  struct s_lcdTiming timing;
+  /**
+   * @var s_lcd::execLoops
+   * _delay_loop_2 count for timing.execUs at F_CPU
+   */
+  uint16_t execLoops;
+  /**
+   * @var s_lcd::longLoops
+   * _delay_loop_2 count for timing.longUs at F_CPU
+   */
+  uint16_t longLoops;
+  /**
+   * @var s_lcd::pulseLoops
+   * _delay_loop_1 count for timing.pulseNs at F_CPU
+   */
+  uint8_t pulseLoops;
+  /**
+   * @var s_lcd::p_glyphs
+   * glyph (flash address of its 8 byte bitmap) loaded in each CGRAM slot, NULL if free
+   */
+  const uint8_t *p_glyphs[LCD_GLYPH_SLOTS];
+  /**
+   * @var s_lcd::glyphOrder
+   * CGRAM slots from most to least recently used
+   */
+  uint8_t glyphOrder[LCD_GLYPH_SLOTS];
+  /**
+   * @var s_lcd::p_shadow
+   * optional shadow copy of the screen (rows * cols bytes), NULL if unused.
+   */
+  uint8_t *p_shadow;
+  /**
+   * @var s_lcd::p_dirty
+   * bitmap of shadow cells that differ from the display, one bit per cell.
+   */
+  uint8_t *p_dirty;
+  /**
+   * @var s_lcd::rows
+   * number of rows held in the shadow buffer
+   */
+  uint8_t rows;
+  /**
+   * @var s_lcd::cols
+   * number of columns held in the shadow buffer
+   */
+  uint8_t cols;
+  /**
+   * @var s_lcd::p_queue
+   * optional ring buffer of queued bytes (data | regSel << 8), NULL if unused.
+   */
+  uint16_t *p_queue;
+  /**
+   * @var s_lcd::queueMask
+   * size of the ring buffer minus one (size is a power of 2).
+   */
+  uint8_t queueMask;
+  /**
+   * @var s_lcd::queueHead
+   * index the next queued byte is written to.
+   */
+  volatile uint8_t queueHead;
+  /**
+   * @var s_lcd::queueTail
+   * index of the byte being sent to the display.
+   */
+  volatile uint8_t queueTail;
+  /**
+   * @var s_lcd::queuePolicy
+   * what to do when the queue is full (LCD_QUEUE_DROP or LCD_QUEUE_BLOCK).
+   */
+  uint8_t queuePolicy;
+  /**
+   * @var s_lcd::queueDrops
+   * number of bytes dropped because the queue was full.
+   */
+  uint8_t queueDrops;
+  /**
+   * @var s_lcd::queueWait
+   * ticks left before the display accepts the next byte.
+   */
+  volatile uint8_t queueWait;
+  /**
+   * @var s_lcd::queuePhase
+   * 1 when the top nibble of a 4 bit write has been sent.
+   */
+  volatile uint8_t queuePhase;
+  /**
+   * @var s_lcd::queuePolled
+   * 1 when the queue is drained by serviceLCD instead of an interrupt.
+   */
+  uint8_t queuePolled;
+  /**
+   * @var s_lcd::serviceStart
+   * serviceLCD time of the last bus step.
+   */
+  uint16_t serviceStart;
+  /**
+   * @var s_lcd::serviceWait
+   * microseconds after serviceStart the display accepts the next step.
+   */
+  uint16_t serviceWait;
+  /**
+   * @var s_lcd::busWrite
+   * write method used to reach the display while the queue is attached.
+   */
+  write_callback busWrite;
+  /**
+   * @var s_lcd::p_map
+   * data line pin map, NULL when the data lines are contiguous on p_dataPort.
+   */
+  struct s_lcdMap *p_map;
+  /**
+   * @var s_lcd::twiSend
+   * I2C transaction for a PCF8574 backpack, NULL on a parallel bus.
+   */
+  twi_callback twiSend;
+  /**
+   * @var s_lcd::twiAddr
+   * 7 bit I2C address of the backpack
+   */
+  uint8_t twiAddr;
+  /**
+   * @var s_lcd::twiByteUs
+   * time of one expander byte on the I2C bus, 9 SCL clocks
+   */
+  uint16_t twiByteUs;
+  /**
+   * @var s_lcd::twiPad
+   * idle expander bytes sent ahead of each LCD byte for the settle time two bytes don't cover
+   */
+  uint8_t twiPad;
+  /**
+   * @var s_lcd::backlight
+   * LCD_PCF_BL when the backpack backlight is on
+   */
+  uint8_t backlight;
+  /**
+   * @var s_lcd::p_batch
+   * expander bytes waiting to go out in one I2C transaction
+   */
+  uint8_t *p_batch;
+  /**
+   * @var s_lcd::batchSize
+   * size of p_batch
+   */
+  uint8_t batchSize;
+  /**
+   * @var s_lcd::batchLen
+   * bytes in p_batch, sent when full and at the end of every call
+   */
+  uint8_t batchLen;
+  /**
+   * @var s_lcd::latch
+   * bit of the 74HC595 RCLK pin on p_ctrlPort, 0 when not on SPI.
+   */
+  uint8_t latch;
+  /**
+   * @var s_lcd::spiSettle
+   * 1 after an SPI byte, the next write waits the exec time less its own shifting.
+   */
+  uint8_t spiSettle;
+  /**
+   * @var s_lcd::scrubPhase
+   * 0 while scrubLCD checks the display, else the restart step it is on.
+   */
+  uint8_t scrubPhase;
+  /**
+   * @var s_lcd::scrubIndex
+   * next byte scrubLCD checks, shadow cells first, then CGRAM, then the line mode.
+   */
+  uint16_t scrubIndex;
+  /**
+   * @var s_lcd::scrubWait
+   * microseconds the restart still has to wait before its next step.
+   */
+  uint16_t scrubWait;
+  /**
+   * @var s_lcd::scrubRepairs
+   * DDRAM and CGRAM bytes rewritten by scrubLCD since init, wraps.
+   */
+  uint16_t scrubRepairs;
+  /**
+   * @var s_lcd::scrubRestarts
+   * times scrubLCD found the controller out of its bus or line mode since init, wraps.
+   */
+  uint8_t scrubRestarts;
+#ifdef HITACHI_LCD_STATS
+  /**
+   * @var s_lcd::stats
+   * driver cost counters
+   */
+  struct s_lcdStats stats;
+#endif
 };
 
 /***************************************************************************//**
- * @brief   Initialize hitachi LCD port with data set for 0 to 3, 4 = enable, 5 = RS
+ * @brief   pick how the following inits start the controller. After a
+ *          watchdog or soft reset the display stayed powered, LCD_INIT_WARM
+ *          or LCD_INIT_PROBE resync the bus and reissue function set,
+ *          display control and entry mode in well under a millisecond
+ *          instead of the 60 ms power on sequence. s_lcd::warm tells
+ *          which way an init went.
+ *
+ * @param   mode LCD_INIT_COLD (default), LCD_INIT_WARM or LCD_INIT_PROBE
+ ******************************************************************************/
+void setInitModeLCD(uint8_t mode);
+
+/***************************************************************************//**
+ * @brief   Initialize hitachi LCD port with data set for 0 to 3, 4 = enable, 5 = RS
+ *
+ * @param   p_temp LCD struct pointer
+ * @param   p_dataPort pointer to data register (PORT).
+ * @param   screenSize size of the screen (in number of characters).
+ * @param   width number of rows of the screen.
+ * @param   precision decimal presented.
+ * @param   base number base (10, 16)
+ ******************************************************************************/
+void initLCD(struct s_lcd *p_temp, volatile uint8_t *p_dataPort, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+
+/***************************************************************************//**
+ * @brief   Initialize hitachi LCD ports for correct I/O and set pin numbers
+ *
+ * @param   p_temp LCD struct pointer
+ * @param   p_dataPort pointer to data register (PORT).
+ * @param   p_ctrlPort pointer to control register (PORT).
+ * @param   rs pin to use for register select on ctrlPort
+ * @param   ena pin to use for enable select on ctrlPort
+ * @param   mode 0 for 4 bit mode, anything else is 8 bit.
+ * @param   screenSize size of the screen (in number of characters).
+ * @param   width number of rows of the screen.
+ * @param   precision decimal presented.
+ * @param   base number base (10, 16)
+ ******************************************************************************/
+void initLCD_custom(struct s_lcd *p_temp, volatile uint8_t *p_dataPort, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+
+/***************************************************************************//**
+ * @brief   Initialize hitachi LCD ports with a R/W pin so the busy flag is
+ *          polled instead of waiting the worst case delay after every write.
+ *          Falls back to fixed delays if the busy flag never clears within
+ *          the exec time of the profile (the long one after clear and home),
+ *          counted as 3us a poll in 8 bit mode and 5us in 4 bit mode, so a
+ *          timeout costs at most that time and one more poll.
+ *
+ * @param   p_temp LCD struct pointer
+ * @param   p_dataPort pointer to data register (PORT).
+ * @param   p_ctrlPort pointer to control register (PORT).
+ * @param   rs pin to use for register select on ctrlPort
+ * @param   ena pin to use for enable select on ctrlPort
+ * @param   rw pin to use for read/write on ctrlPort, LCD_NO_RW if tied low.
+ * @param   mode 0 for 4 bit mode, anything else is 8 bit.
+ * @param   screenSize size of the screen (in number of characters).
+ * @param   width number of rows of the screen.
+ * @param   precision decimal presented.
+ * @param   base number base (10, 16)
+ ******************************************************************************/
+void initLCD_customRW(struct s_lcd *p_temp, volatile uint8_t *p_dataPort, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t rw, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+
+/***************************************************************************//**
+ * @brief   Initialize hitachi LCD with the data lines on any pins of up to
+ *          two ports. Each write is one read-modify-write per port from the
+ *          tables built here, so it costs about the same as contiguous lines.
+ *          If p_map is NULL or uses more ports the display isn't touched and
+ *          p_temp is unusable: calls on it are safe but write nothing.
+ *
+ * @param   p_temp LCD struct pointer
+ * @param   p_map pin map of the data lines (D4-D7 in 4 bit mode), kept in use.
+ * @param   p_ctrlPort pointer to control register (PORT).
+ * @param   rs pin to use for register select on ctrlPort
+ * @param   ena pin to use for enable select on ctrlPort
+ * @param   rw pin to use for read/write on ctrlPort, LCD_NO_RW if tied low.
+ * @param   mode 0 for 4 bit mode, anything else is 8 bit.
+ * @param   screenSize size of the screen (in number of characters).
+ * @param   width number of rows of the screen.
+ * @param   precision decimal presented.
+ * @param   base number base (10, 16)
+ ******************************************************************************/
+void initLCD_map(struct s_lcd *p_temp, struct s_lcdMap *p_map, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t rw, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+
+/***************************************************************************//**
+ * @brief   Initialize hitachi LCD on a PCF8574 I2C backpack (4 bit mode,
+ *          P0 RS, P1 RW, P2 E, P3 backlight, P4-P7 D4-D7). Each nibble is
+ *          two expander bytes (E high, E low) and the bytes of a whole call
+ *          go out in as few transactions as p_batch allows. The settle time
+ *          of a byte is the two expander bytes of the next one's top nibble,
+ *          enough at 100 kHz which init assumes. Call setTwiClockLCD for a
+ *          faster bus, idle expander bytes then make up the difference.
  *
  * @param   p_temp LCD struct pointer
- * @param   p_dataPort pointer to data register (PORT).
+ * @param   twiSend I2C write transaction, twiSendLCD on the AVR TWI.
+ * @param   address 7 bit I2C address of the backpack (0x27 or 0x3F usually)
+ * @param   p_batch buffer for expander bytes, 4 per LCD byte, kept in use.
+ * @param   batchSize size of p_batch, at least 2.
  * @param   screenSize size of the screen (in number of characters).
  * @param   width number of rows of the screen.
  * @param   precision decimal presented.
  * @param   base number base (10, 16)
  ******************************************************************************/
-void initLCD(struct s_lcd *p_temp, volatile uint8_t *p_dataPort, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+void initLCD_twi(struct s_lcd *p_temp, twi_callback twiSend, uint8_t address, uint8_t *p_batch, uint8_t batchSize, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
 
 /***************************************************************************//**
- * @brief   Initialize hitachi LCD ports for correct I/O and set pin numbers
+ * @brief   Initialize hitachi LCD behind 74HC595 shift registers on the
+ *          hardware SPI at F_CPU/2. The register next to the SPI has Q0 RS,
+ *          Q1 RW (keep low), Q2 E, Q3 backlight and in 4 bit mode D4-D7 on
+ *          Q4-Q7. In 8 bit mode a second chained register has D0-D7. The
+ *          settle time of a byte is waited before the enable of the next one
+ *          falls, less only the time taken to shift that byte in. Time spent
+ *          between the two calls is not known to the driver and is not
+ *          taken off, the full exec time of the profile is waited.
  *
  * @param   p_temp LCD struct pointer
- * @param   p_dataPort pointer to data register (PORT).
- * @param   p_ctrlPort pointer to control register (PORT).
- * @param   rs pin to use for register select on ctrlPort
- * @param   ena pin to use for enable select on ctrlPort
- * @param   mode 0 for 4 bit mode, anything else is 8 bit.
+ * @param   p_latchPort pointer to the register (PORT) with the RCLK pin.
+ * @param   latch pin of RCLK, shared by both registers in 8 bit mode.
+ * @param   mode 0 for 4 bit mode, anything else is 8 bit with two registers.
  * @param   screenSize size of the screen (in number of characters).
  * @param   width number of rows of the screen.
  * @param   precision decimal presented.
  * @param   base number base (10, 16)
  ******************************************************************************/
-void initLCD_custom(struct s_lcd *p_temp, volatile uint8_t *p_dataPort, volatile uint8_t *p_ctrlPort, uint8_t rs, uint8_t ena, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+void initLCD_spi(struct s_lcd *p_temp, volatile uint8_t *p_latchPort, uint8_t latch, uint8_t mode, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+
+/***************************************************************************//**
+ * @brief   Turn the backpack or shift register backlight on, nothing on a
+ *          parallel bus.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void backlightOnLCD(struct s_lcd *p_lcd);
+
+/***************************************************************************//**
+ * @brief   Turn the backpack or shift register backlight off, nothing on a
+ *          parallel bus.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void backlightOffLCD(struct s_lcd *p_lcd);
+
+#ifndef HITACHI_LCD_HOST
+/***************************************************************************//**
+ * @brief   Setup the AVR TWI as bus master for twiSendLCD.
+ *
+ * @param   frequency SCL in Hz, 100000 for a PCF8574 by the book.
+ ******************************************************************************/
+void twiInitLCD(uint32_t frequency);
+
+/***************************************************************************//**
+ * @brief   Polled AVR TWI write transaction, usable as twi_callback.
+ *
+ * @param   address 7 bit I2C address
+ * @param   p_data bytes to write
+ * @param   length number of bytes
+ ******************************************************************************/
+void twiSendLCD(uint8_t address, uint8_t *p_data, uint8_t length);
+#endif
+
+#ifdef HITACHI_LCD_STATIC
+/***************************************************************************//**
+ * @brief   Setup LCD with the ports, pins and bus width from
+ *          hitachiLcdConfig.h. Writes to it skip the write callback and use
+ *          constant port addresses. Other displays in the same build can
+ *          still use initLCD_custom.
+ *
+ * @param   p_temp LCD struct pointer
+ * @param   screenSize size of the screen (in number of characters).
+ * @param   width number of rows of the screen.
+ * @param   precision decimal presented.
+ * @param   base number base (10, 16)
+ ******************************************************************************/
+void initLCD_static(struct s_lcd *p_temp, uint8_t screenSize, uint8_t width, uint8_t precision, uint8_t base);
+#endif
+
+/***************************************************************************//**
+ * @brief   set the screen layout. Init picks one from screenSize (16 is
+ *          16x1, 40 is 20x2, 64 is 16x4, 80 is 20x4, anything else 16x2),
+ *          a 40x2 screen has to be set here.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_geometry descriptor in flash (PROGMEM), e.g. &g_lcdGeometry40x2
+ ******************************************************************************/
+void setGeometryLCD(struct s_lcd *p_lcd, const struct s_lcdGeometry *p_geometry);
 
 /***************************************************************************//**
- * @brief   print string to LCD
+ * @brief   set the controller timings. Init uses g_lcdTimingHD44780, a clone
+ *          that runs faster or a 3V module that runs slower can be set here.
+ *          Delays are counted in cycles of F_CPU, not rounded to whole us.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_timing profile in flash (PROGMEM), e.g. &g_lcdTimingST7066
+ ******************************************************************************/
+void setTimingLCD(struct s_lcd *p_lcd, const struct s_lcdTiming *p_timing);
+
+/***************************************************************************//**
+ * @brief   set the I2C clock of a PCF8574 backpack. Two expander bytes have
+ *          to last the exec time of the timing profile, up to 100 kHz they
+ *          do. Above that idle expander bytes go ahead of each LCD byte, one
+ *          at 400 kHz with g_lcdTimingHD44780. Does nothing on other buses.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   frequency SCL in Hz, as given to twiInitLCD
+ ******************************************************************************/
+void setTwiClockLCD(struct s_lcd *p_lcd, uint32_t frequency);
+
+/***************************************************************************//**
+ * @brief   print string to LCD. Text continues at the start of the next row
+ *          after the last column (the first row after the last one) while
+ *          the cursor address is known and the entry mode is left to right
+ *          without autoscroll.
  *
  * @param   p_lcd LCD struct pointer
  * @param   message Null terminated string to print
  ******************************************************************************/
 void printLCD(struct s_lcd *p_lcd, char *message);
 
+/***************************************************************************//**
+ * @brief   print string from flash to LCD, wraps like printLCD.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_message Null terminated string in flash (PSTR or PROGMEM)
+ ******************************************************************************/
+void printLCD_P(struct s_lcd *p_lcd, const char *p_message);
+
+/***************************************************************************//**
+ * @brief   replay a screen program from flash. Cursor moves that land where
+ *          the address counter already is are not sent, characters wrap
+ *          like printLCD. Stops at LCD_SCR_END or an unknown opcode.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_program LCD_SCR_* opcodes and characters in flash (PROGMEM)
+ * @param   pp_glyphs pointer table in RAM to glyph bitmaps in flash for
+ *          LCD_SCR_GLYPH, NULL if unused
+ * @param   glyphCount entries in pp_glyphs, an index past it prints ' '
+ * @param   field called for each LCD_SCR_FIELD, NULL leaves width spaces
+ ******************************************************************************/
+void runScreenLCD(struct s_lcd *p_lcd, const uint8_t *p_program, const uint8_t * const *pp_glyphs, uint8_t glyphCount, field_callback field);
+
+/***************************************************************************//**
+ * @brief   bind a stdio stream to the LCD so fprintf writes straight to the
+ *          display without a RAM buffer. \n moves to the start of the next
+ *          row, \r to the start of the current row and \f clears the
+ *          screen, rows come from the geometry. On the host p_stream is not
+ *          used, the stream comes from fopencookie and is closed with fclose.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_stream FILE to setup with fdev_setup_stream, kept in use.
+ *
+ * @return  stream for fprintf, NULL on error.
+ ******************************************************************************/
+FILE *openStreamLCD(struct s_lcd *p_lcd, FILE *p_stream);
+
 /***************************************************************************//**
  * @brief   print int to LCD
  *
@@ -203,13 +1145,63 @@ void printLCD(struct s_lcd *p_lcd, char *message);
 void printIntLCD(struct s_lcd *p_lcd, int number);
 
 /***************************************************************************//**
- * @brief   print decimal(double) to LCD
+ * @brief   print decimal(double) to LCD with precision digits, right aligned
+ *          to width. NaN, infinity and numbers of 2^32 and up print width
+ *          '#' (one if width is 0). Prefer printFixedLCD to keep floating
+ *          point out of the build.
  *
  * @param   p_lcd LCD struct pointer
  * @param   number double to print
  ******************************************************************************/
 void printDecLCD(struct s_lcd *p_lcd, double number);
 
+/***************************************************************************//**
+ * @brief   print signed integer (int8/16/32) to LCD without a buffer
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   number integer to print
+ * @param   base number base, 2 to 36
+ * @param   width minimum number of characters, 0 for none
+ * @param   flags LCD_FMT_ZERO, LCD_FMT_LEFT, LCD_FMT_PLUS, LCD_FMT_UPPER or'ed
+ ******************************************************************************/
+void printSignedLCD(struct s_lcd *p_lcd, int32_t number, uint8_t base, uint8_t width, uint8_t flags);
+
+/***************************************************************************//**
+ * @brief   print unsigned integer (uint8/16/32) to LCD without a buffer
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   number integer to print
+ * @param   base number base, 2 to 36
+ * @param   width minimum number of characters, 0 for none
+ * @param   flags LCD_FMT_ZERO, LCD_FMT_LEFT, LCD_FMT_UPPER or'ed
+ ******************************************************************************/
+void printUnsignedLCD(struct s_lcd *p_lcd, uint32_t number, uint8_t base, uint8_t width, uint8_t flags);
+
+/***************************************************************************//**
+ * @brief   print hex to LCD without a buffer, width 2 with LCD_FMT_ZERO
+ *          gives a byte.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   number integer to print
+ * @param   width minimum number of characters, 0 for none
+ * @param   flags LCD_FMT_ZERO, LCD_FMT_LEFT, LCD_FMT_UPPER or'ed
+ ******************************************************************************/
+void printHexLCD(struct s_lcd *p_lcd, uint32_t number, uint8_t width, uint8_t flags);
+
+/***************************************************************************//**
+ * @brief   print Q format fixed point to LCD without floating point,
+ *          rounded half away from zero to precision digits. e.g. Q8 value
+ *          0x0380 with precision 2 prints 3.50
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   number fixed point value
+ * @param   fracBits number of fraction bits, up to 28
+ * @param   precision digits after the decimal point, up to 9
+ * @param   width minimum number of characters, 0 for none
+ * @param   flags LCD_FMT_ZERO, LCD_FMT_LEFT, LCD_FMT_PLUS or'ed
+ ******************************************************************************/
+void printFixedLCD(struct s_lcd *p_lcd, int32_t number, uint8_t fracBits, uint8_t precision, uint8_t width, uint8_t flags);
+
 /***************************************************************************//**
  * @brief   print raw 8 bit data to LCD
  *
@@ -219,7 +1211,40 @@ void printDecLCD(struct s_lcd *p_lcd, double number);
 void printSpecialLCD(struct s_lcd *p_lcd, uint8_t message);
 
 /***************************************************************************//**
- * @brief   set cursor to a position on screen (columns by rows)
+ * @brief   load a custom character into a CGRAM slot. The cursor is put back
+ *          where it was when its address is known.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   slot CGRAM slot, 0 to 7, printSpecialLCD(slot) shows it.
+ * @param   p_glyph 8 byte bitmap in flash (PROGMEM), 5 low bits per row.
+ ******************************************************************************/
+void loadGlyphLCD(struct s_lcd *p_lcd, uint8_t slot, const uint8_t *p_glyph);
+
+/***************************************************************************//**
+ * @brief   get the character code of a glyph, loading it into the least
+ *          recently used CGRAM slot on a miss. Characters already on screen
+ *          from an evicted glyph change to the new one.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_glyph 8 byte bitmap in flash (PROGMEM), its address is its ID.
+ *
+ * @return  character code to pass to printSpecialLCD, ' ' for a NULL p_glyph
+ *          which leaves CGRAM and the cache alone.
+ ******************************************************************************/
+uint8_t glyphLCD(struct s_lcd *p_lcd, const uint8_t *p_glyph);
+
+/***************************************************************************//**
+ * @brief   forget which glyphs are in CGRAM, every glyph is loaded again on
+ *          its next use.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void invalidateGlyphsLCD(struct s_lcd *p_lcd);
+
+/***************************************************************************//**
+ * @brief   set cursor to a position on screen (columns by rows), nothing is
+ *          sent if the address counter is already there. Rows past the
+ *          screen go to the first row.
  *
  * @param   p_lcd LCD struct pointer
  * @param   row number to index starting at 0
@@ -227,6 +1252,15 @@ void printSpecialLCD(struct s_lcd *p_lcd, uint8_t message);
  ******************************************************************************/
 void setCursorLCD(struct s_lcd *p_lcd, uint8_t row, uint8_t col);
 
+/***************************************************************************//**
+ * @brief   forget the tracked cursor address so the next setCursorLCD is
+ *          always sent. Needed after writing to the display behind the
+ *          library's back.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void invalidateCursorLCD(struct s_lcd *p_lcd);
+
 /***************************************************************************//**
  * @brief   clear screen and set cursor for home
  *
@@ -325,5 +1359,312 @@ void autoscrollOffLCD(struct s_lcd *p_lcd);
  ******************************************************************************/
 void autoscrollOnLCD(struct s_lcd *p_lcd);
 
+/***************************************************************************//**
+ * @brief   attach a shadow buffer that mirrors the display contents in RAM.
+ *          All cells are marked dirty so the first flush syncs the screen.
+ *          Cells are placed with the row addresses of the geometry.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_shadow buffer of rows * cols bytes, NULL to detach.
+ * @param   p_dirty buffer of LCD_SHADOW_DIRTY_SIZE(rows, cols) bytes.
+ * @param   rows number of rows of the screen, 0 for the geometry rows.
+ * @param   cols number of columns of the screen, 0 for the geometry cols.
+ ******************************************************************************/
+void attachShadowLCD(struct s_lcd *p_lcd, uint8_t *p_shadow, uint8_t *p_dirty, uint8_t rows, uint8_t cols);
+
+/***************************************************************************//**
+ * @brief   print string into the shadow buffer, clipped at the end of the row.
+ *          Nothing is sent to the display until flushLCD is called.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   row number to index starting at 0
+ * @param   col number to index starting at 0
+ * @param   message Null terminated string to print
+ ******************************************************************************/
+void printShadowLCD(struct s_lcd *p_lcd, uint8_t row, uint8_t col, char *message);
+
+/***************************************************************************//**
+ * @brief   put raw 8 bit data into one cell of the shadow buffer.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   row number to index starting at 0
+ * @param   col number to index starting at 0
+ * @param   message 8bit value to place in the cell
+ ******************************************************************************/
+void putShadowLCD(struct s_lcd *p_lcd, uint8_t row, uint8_t col, uint8_t message);
+
+/***************************************************************************//**
+ * @brief   fill the shadow buffer with spaces, replaces clearLCD without the
+ *          2 ms clear command and the flicker that comes with it.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void clearShadowLCD(struct s_lcd *p_lcd);
+
+/***************************************************************************//**
+ * @brief   mark every shadow cell dirty, use after writing to the display
+ *          without going through the shadow buffer.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void invalidateShadowLCD(struct s_lcd *p_lcd);
+
+/***************************************************************************//**
+ * @brief   write only the changed shadow cells to the display. Rows go out
+ *          in DDRAM address order and adjacent dirty cells are sent as one
+ *          set DDRAM address followed by an auto increment burst, which
+ *          runs on from the end of a row into the next row in DDRAM (row 0
+ *          into row 2 on 4 row screens). Leaves the cursor after the last
+ *          written cell.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void flushLCD(struct s_lcd *p_lcd);
+
+/***************************************************************************//**
+ * @brief   flush the shadows of several displays at once, for panels sharing
+ *          data and RS lines with their own enable pin. One byte goes to
+ *          each panel per round, so a panel settles while the others are
+ *          written and each round waits for the settle time only once.
+ *          Panels with a queue attached or a serial bus are flushed one by
+ *          one with flushLCD. More than LCD_GROUP_MAX panels are flushed in
+ *          groups of LCD_GROUP_MAX, one group after the other.
+ *
+ * @param   pp_lcd array of LCD struct pointers
+ * @param   count number of displays in pp_lcd
+ ******************************************************************************/
+void flushGroupLCD(struct s_lcd **pp_lcd, uint8_t count);
+
+/***************************************************************************//**
+ * @brief   read back a few bytes of the display and rewrite the ones that
+ *          differ, call it from the main loop to recover from glitches. Each
+ *          call goes on where the last one stopped: shadow cells, the CGRAM
+ *          rows of resident glyphs, then a check of the line mode along
+ *          with the display control that can't be read back. A controller
+ *          that answers with the wrong address has lost its bus mode and
+ *          is taken through the reset sequence over the next calls, the
+ *          shadow is invalidated then and the next flushLCD puts the screen
+ *          back. Each command, busy poll and read
+ *          is costed at the profile exec time plus 4us, a call stops before
+ *          its estimate goes over budgetUs. Needs R/W on a parallel bus and no
+ *          queue, does nothing otherwise. The cursor is put back.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   budgetUs time the call may take, at least 8 exec times to get anywhere
+ *
+ * @return  bytes rewritten in this call, s_lcd::scrubRepairs keeps the total.
+ ******************************************************************************/
+uint8_t scrubLCD(struct s_lcd *p_lcd, uint16_t budgetUs);
+
+/***************************************************************************//**
+ * @brief   open a window on the shadow buffer, clipped to the shadow. The
+ *          window is not cleared and the cursor is at its top left.
+ *
+ * @param   p_lcd LCD struct pointer, with a shadow buffer attached
+ * @param   p_window window state, kept by the caller
+ * @param   row top row of the window
+ * @param   col left column of the window
+ * @param   rows rows in the window, 0 for the rest of the screen
+ * @param   cols columns in the window, 0 for the rest of the screen
+ * @param   flags LCD_WIN_WRAP, LCD_WIN_SCROLL or'ed, 0 to cut text off
+ ******************************************************************************/
+void openWindowLCD(struct s_lcd *p_lcd, struct s_lcdWindow *p_window, uint8_t row, uint8_t col, uint8_t rows, uint8_t cols, uint8_t flags);
+
+/***************************************************************************//**
+ * @brief   print string into a window at its cursor. \n starts the next
+ *          line, \r goes back to the start of the line and \f clears the
+ *          window. Only the shadow is written.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_window window state from openWindowLCD
+ * @param   message Null terminated string to print
+ ******************************************************************************/
+void printWindowLCD(struct s_lcd *p_lcd, struct s_lcdWindow *p_window, char *message);
+
+/***************************************************************************//**
+ * @brief   set the cursor of a window, relative to its top left.
+ *
+ * @param   p_window window state from openWindowLCD
+ * @param   row number to index starting at 0
+ * @param   col number to index starting at 0
+ ******************************************************************************/
+void setCursorWindowLCD(struct s_lcdWindow *p_window, uint8_t row, uint8_t col);
+
+/***************************************************************************//**
+ * @brief   fill a window with spaces and put its cursor top left.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_window window state from openWindowLCD
+ ******************************************************************************/
+void clearWindowLCD(struct s_lcd *p_lcd, struct s_lcdWindow *p_window);
+
+/***************************************************************************//**
+ * @brief   move the contents of a window up one line and blank the bottom
+ *          line. Cells outside the window and cells that don't change stay
+ *          clean, so a scrolling log only costs its own changed cells.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_window window state from openWindowLCD
+ ******************************************************************************/
+void scrollWindowLCD(struct s_lcd *p_lcd, struct s_lcdWindow *p_window);
+
+/***************************************************************************//**
+ * @brief   start text scrolling right to left through a window of one row and
+ *          draw the first frame. LCD_MARQUEE_SHIFT moves the whole display
+ *          with the shift command, so every row scrolls with it, and needs a
+ *          window over a full row of a 1 or 2 row screen with DDRAM off
+ *          screen (not 40x2, 16x1 or 4 rows). Otherwise LCD_MARQUEE_ROW is
+ *          used, which leaves the rest of the screen alone.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_marquee marquee state, kept by the caller
+ * @param   row number to index starting at 0
+ * @param   col first column of the window
+ * @param   width columns in the window, 0 for the rest of the row
+ * @param   message Null terminated string, up to 255 characters with the gap
+ * @param   gap spaces between the end of the text and its start coming round
+ * @param   mode LCD_MARQUEE_ROW or LCD_MARQUEE_SHIFT
+ ******************************************************************************/
+void startMarqueeLCD(struct s_lcd *p_lcd, struct s_lcdMarquee *p_marquee, uint8_t row, uint8_t col, uint8_t width, char *message, uint8_t gap, uint8_t mode);
+
+/***************************************************************************//**
+ * @brief   scroll a marquee one character to the left. A shift marquee sends
+ *          the shift command and the one character that comes on screen at
+ *          the next step, two commands. If another marquee already shifted
+ *          the display for this step only the character is sent. A row
+ *          marquee writes the cells whose character changes.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_marquee marquee state from startMarqueeLCD
+ ******************************************************************************/
+void stepMarqueeLCD(struct s_lcd *p_lcd, struct s_lcdMarquee *p_marquee);
+
+/***************************************************************************//**
+ * @brief   start an empty bar graph, the cells it covers are blanked.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_bar bar state, kept by the caller
+ * @param   row number to index starting at 0, the bottom cell going up
+ * @param   col number to index starting at 0, the first cell going right
+ * @param   length cells in the bar, up to 51 across or 31 up
+ * @param   direction LCD_BAR_HORIZONTAL or LCD_BAR_VERTICAL
+ ******************************************************************************/
+void startBarLCD(struct s_lcd *p_lcd, struct s_lcdBar *p_bar, uint8_t row, uint8_t col, uint8_t length, uint8_t direction);
+
+/***************************************************************************//**
+ * @brief   set how many pixels of a bar graph are filled. Only the cells that
+ *          change are written, a bar moving by one pixel inside a cell is a
+ *          single character. The partial cell takes a CGRAM slot, 4 glyphs
+ *          across or 7 up are used as the bar moves. If another glyphLCD
+ *          user took that slot the cell is rewritten on the next call, even
+ *          with the level unchanged.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_bar bar state from startBarLCD
+ * @param   level pixels filled, 5 a cell across and 8 up, clipped to the bar
+ ******************************************************************************/
+void setBarLCD(struct s_lcd *p_lcd, struct s_lcdBar *p_bar, uint8_t level);
+
+/***************************************************************************//**
+ * @brief   start a number in big digits, the cells it covers are blanked.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_big big number state, kept by the caller
+ * @param   p_font &g_lcdBigFont2x2, &g_lcdBigFont3x3 or a font of your own
+ * @param   row top row of the digits
+ * @param   col left column of the first digit
+ * @param   digits number of digits, up to LCD_BIG_DIGITS
+ ******************************************************************************/
+void startBigLCD(struct s_lcd *p_lcd, struct s_lcdBig *p_big, const struct s_lcdBigFont *p_font, uint8_t row, uint8_t col, uint8_t digits);
+
+/***************************************************************************//**
+ * @brief   show an unsigned number in big digits, right aligned. Only the
+ *          cells that differ from what is on screen are written, so a
+ *          counter going up mostly costs the last digit. Glyphs of the
+ *          digits on screen that another glyphLCD user evicted are reloaded
+ *          and the cells showing them rewritten, until then those cells show
+ *          the other glyph. A bar next to g_lcdBigFont2x2 digits makes both
+ *          reload on every call.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_big big number state from startBigLCD
+ * @param   number value, the high digits are cut off if it doesn't fit
+ * @param   flags LCD_FMT_ZERO pads with zeros instead of blanks
+ ******************************************************************************/
+void printBigLCD(struct s_lcd *p_lcd, struct s_lcdBig *p_big, uint32_t number, uint8_t flags);
+
+/***************************************************************************//**
+ * @brief   attach a ring buffer so writes are queued and sent from a timer
+ *          interrupt by tickQueueLCD instead of blocking in delays.
+ *          Attach after init, detaching waits for the queue to drain.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_buffer ring buffer storage, NULL to detach.
+ * @param   size number of entries in p_buffer, power of 2 up to 128.
+ * @param   policy LCD_QUEUE_DROP or LCD_QUEUE_BLOCK when the queue is full.
+ ******************************************************************************/
+void attachQueueLCD(struct s_lcd *p_lcd, uint16_t *p_buffer, uint8_t size, uint8_t policy);
+
+/***************************************************************************//**
+ * @brief   send at most one nibble (4 bit) or byte (8 bit) from the queue.
+ *          Call from a timer compare ISR every LCD_QUEUE_TICK_US, e.g.
+ *          ISR(TIMER2_COMPA_vect) { tickQueueLCD(&lcd); }
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void tickQueueLCD(struct s_lcd *p_lcd);
+
+/***************************************************************************//**
+ * @brief   polled alternative to tickQueueLCD for a main loop without a
+ *          timer. Sends at most one nibble (4 bit) or byte (8 bit) from the
+ *          queue if the display is done with the last one, otherwise
+ *          returns at once, it never waits. Worst case per call is the one
+ *          step at 16 MHz: about 4us on a parallel bus, 7us on SPI and the
+ *          8 expander bytes of a byte on a PCF8574 (about 150us at 400 kHz).
+ *          Attach the queue with LCD_QUEUE_DROP, LCD_QUEUE_BLOCK waits in
+ *          the writing call when the queue is full.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   now free running microsecond count, only differences are used
+ *          so it may wrap (e.g. (uint16_t)micros()).
+ *
+ * @return  queued bytes left, 0 when the display is up to date.
+ ******************************************************************************/
+uint8_t serviceLCD(struct s_lcd *p_lcd, uint16_t now);
+
+/***************************************************************************//**
+ * @brief   number of bytes waiting in the queue
+ *
+ * @param   p_lcd LCD struct pointer
+ *
+ * @return  queued bytes, the byte being sent counts until it is done.
+ ******************************************************************************/
+uint8_t queueDepthLCD(struct s_lcd *p_lcd);
+
+/***************************************************************************//**
+ * @brief   wait until the queue is drained. With interrupts disabled or a
+ *          queue serviced by serviceLCD it is drained synchronously.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void waitQueueLCD(struct s_lcd *p_lcd);
+
+#ifdef HITACHI_LCD_STATS
+/***************************************************************************//**
+ * @brief   copy the counters in one go, safe against a queue tick interrupt
+ *          counting at the same time.
+ *
+ * @param   p_lcd LCD struct pointer
+ * @param   p_stats where the copy goes
+ ******************************************************************************/
+void snapshotStatsLCD(struct s_lcd *p_lcd, struct s_lcdStats *p_stats);
+
+/***************************************************************************//**
+ * @brief   zero the counters, e.g. after dumping a snapshot over the UART.
+ *
+ * @param   p_lcd LCD struct pointer
+ ******************************************************************************/
+void resetStatsLCD(struct s_lcd *p_lcd);
+#endif
 
 #endif /* LCD_H_ */
@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * @file    hitachiLcdConfig.h
+ * @author  Jay Convertino(electrobs@gmail.com)
+ * @date    2024.03.11
+ * @brief   Compile time pin configuration of the hitachi LCD library.
+ * @details Only used when built with HITACHI_LCD_STATIC (make LCD_STATIC=1).
+ *          Ports, pins and bus width are constants so the compiler can use
+ *          sbi/cbi/out for the bus writes of initLCD_static displays. Edit the
+ *          defaults below or pass them with -D.
+ * @version 0.6.0
+ *
+ * @license mit
+ *
+ * Copyright 2024 Johnathan Convertino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+
+
+#ifndef _LCD_CONFIG_H_
+#define _LCD_CONFIG_H_
+
+//data lines, D0-D7 on bits 0-7 in 8 bit mode, D4-D7 on bits 0-3 in 4 bit mode
+#ifndef LCD_STATIC_DATA_PORT
+#define LCD_STATIC_DATA_PORT PORTB
+#endif
+
+//port with RS, E and R/W
+#ifndef LCD_STATIC_CTRL_PORT
+#define LCD_STATIC_CTRL_PORT PORTB
+#endif
+
+//register select pin on the control port
+#ifndef LCD_STATIC_RS
+#define LCD_STATIC_RS 5
+#endif
+
+//enable pin on the control port
+#ifndef LCD_STATIC_ENA
+#define LCD_STATIC_ENA 4
+#endif
+
+//read/write pin on the control port, leave undefined if R/W is tied low
+//#define LCD_STATIC_RW 6
+
+//0 for 4 bit mode, 1 for 8 bit mode
+#ifndef LCD_STATIC_MODE
+#define LCD_STATIC_MODE 0
+#endif
+
+#endif /* _LCD_CONFIG_H_ */
@@ -0,0 +1,105 @@
+/*******************************************************************************
+ * @file    hitachiLcdPort.h
+ * @author  Jay Convertino(electrobs@gmail.com)
+ * @date    2024.03.11
+ * @brief   Port and timing access used by the hitachi LCD library.
+ * @details On the AVR the macros are plain register accesses. Building with
+ *          HITACHI_LCD_HOST routes them to the HD44780 model in host/ so the
+ *          library runs on Linux. Building with HITACHI_LCD_LOW_LATENCY
+ *          keeps interrupts on during operations and only protects each
+ *          port read-modify-write. HITACHI_LCD_STATS hooks the interrupts
+ *          off window measurement into the same macros.
+ * @version 0.6.0
+ *
+ * @license mit
+ *
+ * Copyright 2024 Johnathan Convertino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+
+#ifndef _LCD_PORT_H_
+#define _LCD_PORT_H_
+
+#ifdef HITACHI_LCD_HOST
+
+//model supplies SREG, cli(), _delay_us(), _delay_ms(), _delay_loop_1/2(), pgm_read_byte() and the PORTx registers
+#include "hd44780Model.h"
+
+#define LCD_PORT_READ(p)      hostPortRead(p)
+#define LCD_PORT_WRITE(p, v)  hostPortWrite((p), (v))
+#define LCD_PORT_OR(p, m)     LCD_ATOMIC(hostPortWrite((p), (uint8_t)(hostPortRead(p) | (m))))
+#define LCD_PORT_AND(p, m)    LCD_ATOMIC(hostPortWrite((p), (uint8_t)(hostPortRead(p) & (m))))
+
+#define LCD_SPI_INIT()        do {} while(0)
+#define LCD_SPI_START(v)      hostSpiStart(v)
+#define LCD_SPI_WAIT()        hostSpiWait()
+
+#else
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include <util/delay_basic.h>
+#include <avr/common.h>
+#include <avr/pgmspace.h>
+
+#define LCD_PORT_READ(p)      (*(p))
+#define LCD_PORT_WRITE(p, v)  (*(p) = (v))
+#define LCD_PORT_OR(p, m)     LCD_ATOMIC(*(p) |= (m))
+#define LCD_PORT_AND(p, m)    LCD_ATOMIC(*(p) &= (m))
+
+//hardware SPI pins, ATmega328P unless told otherwise. SS has to be an output to stay master.
+#ifndef LCD_SPI_DDR
+#define LCD_SPI_DDR  DDRB
+#define LCD_SPI_MOSI 3
+#define LCD_SPI_SCK  5
+#define LCD_SPI_SS   2
+#endif
+
+//master, mode 0, MSB first, F_CPU/2
+#define LCD_SPI_INIT()        do { LCD_ATOMIC(LCD_SPI_DDR |= (1 << LCD_SPI_MOSI) | (1 << LCD_SPI_SCK) | (1 << LCD_SPI_SS)); SPCR = (1 << SPE) | (1 << MSTR); SPSR = (1 << SPI2X); } while(0)
+#define LCD_SPI_START(v)      (SPDR = (v))
+#define LCD_SPI_WAIT()        while(!(SPSR & (1 << SPIF)))
+
+#endif
+
+#ifdef HITACHI_LCD_STATS
+//a call that turns interrupts off starts a new interrupts off window
+void statIrqSave(uint8_t sreg);
+#define LCD_STAT_IRQ_SAVE(s)  statIrqSave(s)
+#else
+#define LCD_STAT_IRQ_SAVE(s)  do {} while(0)
+#endif
+
+#ifdef HITACHI_LCD_LOW_LATENCY
+//operations keep interrupts as they are, only each port read-modify-write
+//is atomic so an interrupt touching other pins of the port can't be undone.
+//interrupts are off for at most in, cli, ld, or/and, st, out (about 0.5us at 16 MHz).
+#define LCD_IRQ_SAVE(s)       do { (s) = SREG; LCD_STAT_IRQ_SAVE(s); } while(0)
+#define LCD_IRQ_RESTORE(s)    ((void)(s))
+#define LCD_ATOMIC(x)         do { uint8_t lcdSREG = SREG; cli(); x; SREG = lcdSREG; } while(0)
+#else
+//whole operations run with interrupts off
+#define LCD_IRQ_SAVE(s)       do { (s) = SREG; cli(); LCD_STAT_IRQ_SAVE(s); } while(0)
+#define LCD_IRQ_RESTORE(s)    (SREG = (s))
+#define LCD_ATOMIC(x)         x
+#endif
+
+#endif /* _LCD_PORT_H_ */
@@ -0,0 +1,1153 @@
+/*******************************************************************************
+ * @file    hitachiLcdTest.c
+ * @author  Jay Convertino(electrobs@gmail.com)
+ * @date    2024.03.11
+ * @brief   Host checks of the hitachi LCD library against the HD44780 model
+ * @details Drives the library against the host HD44780 model and checks
+ *          what ends up in DDRAM and CGRAM. Every case runs on each bus
+ *          configuration (parallel, mapped lines, 74HC595, PCF8574), a case
+ *          that needs something a configuration lacks (R/W for readback)
+ *          returns early. A case also fails if the model saw a byte
+ *          written while busy or an enable pulse out of spec.
+ *          Prints the failed checks and exits non zero if there were any.
+ * @version 0.6.0
+ *
+ * @license mit
+ *
+ * Copyright 2024 Johnathan Convertino
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "hitachiLcd.h"
+#include "hd44780Model.h"
+
+//wiring used for every configuration, data on PORTD, RS/E/RW on PORTB 0/1/2
+#define TEST_RS  0
+#define TEST_ENA 1
+#define TEST_RW  2
+
+//how the display is wired up
+#define TEST_PARALLEL 0
+#define TEST_MAP      1
+#define TEST_HC595    2
+#define TEST_PCF8574  3
+//400 kHz bus and a batch of one LCD byte a transaction
+#define TEST_PCF8574_FAST 4
+
+//74HC595 RCLK on PORTB 0
+#define TEST_LATCH 0
+
+//backpack address, the bus clock init assumes and the fast one
+#define TEST_TWI_ADDR     0x27
+#define TEST_TWI_SCL      100000UL
+#define TEST_TWI_SCL_FAST 400000UL
+
+#define CHECK(x) testCheck((x), #x, __LINE__)
+
+/**
+ * @struct s_testConfig
+ * @brief One bus configuration
+ */
+struct s_testConfig
+{
+  const char *p_name;
+  uint8_t mode;
+  uint8_t rw;
+  uint8_t wiring;
+};
+
+/**
+ * @struct s_testCase
+ * @brief One group of checks
+ */
+struct s_testCase
+{
+  const char *p_name;
+  void (*run)(const struct s_testConfig *p_config);
+};
+
+//mapped data lines, D0-D3 on PC1 PC2 PD0 PD1, D4-D7 on PC5 PD2 PC0 PD7
+static volatile uint8_t * const gp_mapPorts[8] = {&PORTC, &PORTC, &PORTD, &PORTD, &PORTC, &PORTD, &PORTC, &PORTD};
+static const uint8_t g_mapBits[8] = {1, 2, 0, 1, 5, 2, 0, 7};
+
+static struct s_lcd g_lcd;
+static struct s_hd44780Model g_model;
+static struct s_pcf8574Model g_expander;
+static struct s_hc595Model g_shifter[2];
+static struct s_lcdMap g_map;
+static uint8_t g_batch[64];
+static const char *gp_case;
+static const char *gp_config;
+static unsigned g_checks;
+static unsigned g_failures;
+
+static void testCheck(int pass, const char *p_text, int line)
+{
+  g_checks++;
+
+  if(pass) return;
+
+  g_failures++;
+  printf("FAIL %s %s line %d: %s\n", gp_case, gp_config, line, p_text);
+}
+
+//fresh, powered up model on the configuration's wiring
+static void testWire(const struct s_testConfig *p_config)
+{
+  uint8_t line = 0;
+
+  hostReset();
+
+  hd44780ModelInit(&g_model, HD44780_FOSC_HZ);
+
+  if(p_config->wiring >= TEST_PCF8574)
+  {
+    pcf8574ModelInit(&g_expander, TEST_TWI_ADDR, ((p_config->wiring == TEST_PCF8574_FAST) ? TEST_TWI_SCL_FAST : TEST_TWI_SCL));
+    pcf8574ModelAttach(&g_expander);
+    hd44780ModelWirePcf8574(&g_model, &g_expander);
+  }
+  else if(p_config->wiring == TEST_HC595)
+  {
+    hc595ModelInit(&g_shifter[0], &PORTB, TEST_LATCH);
+    hc595ModelInit(&g_shifter[1], &PORTB, TEST_LATCH);
+
+    if(p_config->mode) hc595ModelChain(&g_shifter[0], &g_shifter[1]);
+
+    hc595ModelAttach(&g_shifter[0]);
+    hd44780ModelWireHc595(&g_model, &g_shifter[0], (p_config->mode ? &g_shifter[1] : NULL));
+  }
+  else if(p_config->wiring == TEST_MAP)
+  {
+    for(line = (p_config->mode ? 0 : 4); line < 8; line++)
+    {
+      hd44780ModelWire(&g_model, HD44780_D0 + line, gp_mapPorts[line], g_mapBits[line]);
+      g_map.p_data[line] = gp_mapPorts[line];
+      g_map.dataBit[line] = g_mapBits[line];
+    }
+
+    hd44780ModelWire(&g_model, HD44780_RS, &PORTB, TEST_RS);
+    hd44780ModelWire(&g_model, HD44780_E, &PORTB, TEST_ENA);
+
+    if(p_config->rw) hd44780ModelWire(&g_model, HD44780_RW, &PORTB, TEST_RW);
+  }
+  else
+  {
+    hd44780ModelWireParallel(&g_model, &PORTD, &PORTB, TEST_RS, TEST_ENA, (p_config->rw ? TEST_RW : 0xFF), p_config->mode);
+  }
+
+  hd44780ModelAttach(&g_model);
+}
+
+//init of a rows x cols display on the configuration's wiring, in the init mode set last
+static void testStart(const struct s_testConfig *p_config, uint8_t rows, uint8_t cols)
+{
+  if(p_config->wiring == TEST_PCF8574_FAST)
+  {
+    initLCD_twi(&g_lcd, pcf8574ModelSend, TEST_TWI_ADDR, g_batch, 4, rows * cols, rows, 2, 10);
+    setTwiClockLCD(&g_lcd, TEST_TWI_SCL_FAST);
+  }
+  else if(p_config->wiring == TEST_PCF8574)
+  {
+    initLCD_twi(&g_lcd, pcf8574ModelSend, TEST_TWI_ADDR, g_batch, sizeof(g_batch), rows * cols, rows, 2, 10);
+  }
+  else if(p_config->wiring == TEST_HC595)
+  {
+    initLCD_spi(&g_lcd, &PORTB, TEST_LATCH, p_config->mode, rows * cols, rows, 2, 10);
+  }
+  else if(p_config->wiring == TEST_MAP)
+  {
+    initLCD_map(&g_lcd, &g_map, &PORTB, TEST_RS, TEST_ENA, (p_config->rw ? TEST_RW : LCD_NO_RW), p_config->mode, rows * cols, rows, 2, 10);
+  }
+  else
+  {
+    initLCD_customRW(&g_lcd, &PORTD, &PORTB, TEST_RS, TEST_ENA, (p_config->rw ? TEST_RW : LCD_NO_RW), p_config->mode, rows * cols, rows, 2, 10);
+  }
+}
+
+//fresh model and a cold init of a rows x cols display on the configuration's wiring
+static void testInit(const struct s_testConfig *p_config, uint8_t rows, uint8_t cols)
+{
+  testWire(p_config);
+
+  setInitModeLCD(LCD_INIT_COLD);
+  testStart(p_config, rows, cols);
+}
+
+//1 if the screen shows p_text from row, col on
+static int testRow(uint8_t row, uint8_t col, const char *p_text)
+{
+  for(; *p_text != '\0'; p_text++, col++)
+  {
+    if(hd44780ModelCell(&g_model, row, col, g_lcd.geometry.cols) != (uint8_t)*p_text) return 0;
+  }
+
+  return 1;
+}
+
+//text, cursor moves and wrapping into the next row
+static void testPrint(const struct s_testConfig *p_config)
+{
+  testInit(p_config, 4, 20);
+
+  printLCD(&g_lcd, "Hello World");
+  setCursorLCD(&g_lcd, 1, 3);
+  printIntLCD(&g_lcd, -1234);
+  setCursorLCD(&g_lcd, 2, 16);
+  printLCD(&g_lcd, "wrapped");
+
+  CHECK(testRow(0, 0, "Hello World "));
+  CHECK(testRow(1, 0, "   -1234 "));
+  CHECK(testRow(2, 16, "wrap"));
+  CHECK(testRow(3, 0, "ped "));
+
+  clearLCD(&g_lcd);
+  printLCD(&g_lcd, "abc");
+
+  CHECK(testRow(0, 0, "abc        "));
+  CHECK(testRow(1, 0, "         "));
+}
+
+//flush sends the changed cells only, clearing the shadow blanks the screen
+static void testShadow(const struct s_testConfig *p_config)
+{
+  static uint8_t shadow[4 * 20];
+  static uint8_t dirty[LCD_SHADOW_DIRTY_SIZE(4, 20)];
+  uint32_t dataWrites = 0;
+
+  testInit(p_config, 4, 20);
+  attachShadowLCD(&g_lcd, shadow, dirty, 0, 0);
+
+  printShadowLCD(&g_lcd, 0, 0, "Temp: 21.5C");
+  printShadowLCD(&g_lcd, 3, 15, "clipped");
+  putShadowLCD(&g_lcd, 2, 19, '*');
+
+  //nothing goes out before the flush
+  CHECK(testRow(0, 0, "    "));
+
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(0, 0, "Temp: 21.5C "));
+  CHECK(testRow(2, 19, "*"));
+  CHECK(testRow(3, 15, "clipp"));
+
+  dataWrites = g_model.dataWrites;
+  printShadowLCD(&g_lcd, 0, 6, "22.5");
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(0, 0, "Temp: 22.5C "));
+  CHECK((g_model.dataWrites - dataWrites) == 1);
+
+  clearShadowLCD(&g_lcd);
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(0, 0, "           "));
+  CHECK(testRow(3, 15, "     "));
+}
+
+//cursor moves to where the address counter already is cost nothing
+static void testCursor(const struct s_testConfig *p_config)
+{
+  uint32_t instructions = 0;
+
+  testInit(p_config, 2, 16);
+
+  setCursorLCD(&g_lcd, 1, 4);
+  printLCD(&g_lcd, "ab");
+
+  instructions = g_model.instructions;
+  setCursorLCD(&g_lcd, 1, 6);
+  printLCD(&g_lcd, "cd");
+
+  CHECK(g_model.instructions == instructions);
+  CHECK(testRow(1, 4, "abcd"));
+
+  //a forgotten address always goes out
+  invalidateCursorLCD(&g_lcd);
+  setCursorLCD(&g_lcd, 1, 8);
+
+  CHECK(g_model.instructions == (instructions + 1));
+}
+
+//glyph cache fills all slots, a hit uploads nothing and a miss replaces the least recently used
+static void testGlyphs(const struct s_testConfig *p_config)
+{
+  static const uint8_t glyphs[LCD_GLYPH_SLOTS + 1][8] PROGMEM =
+  {
+    {0x01}, {0x02}, {0x03}, {0x04}, {0x05}, {0x06}, {0x07}, {0x08}, {0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F}
+  };
+  uint8_t slots[LCD_GLYPH_SLOTS];
+  uint8_t slot = 0;
+  uint8_t index = 0;
+  uint32_t dataWrites = 0;
+
+  testInit(p_config, 2, 16);
+  setCursorLCD(&g_lcd, 1, 2);
+
+  for(index = 0; index < LCD_GLYPH_SLOTS; index++)
+  {
+    slots[index] = glyphLCD(&g_lcd, glyphs[index]);
+    printSpecialLCD(&g_lcd, slots[index]);
+
+    CHECK(g_model.cgram[slots[index] * 8] == (index + 1));
+  }
+
+  //uploads put the cursor back, the glyphs went out one after the other
+  CHECK(hd44780ModelCell(&g_model, 1, 2, 16) == slots[0]);
+  CHECK(hd44780ModelCell(&g_model, 1, 9, 16) == slots[7]);
+
+  dataWrites = g_model.dataWrites;
+
+  CHECK(glyphLCD(&g_lcd, glyphs[0]) == slots[0]);
+  CHECK(g_model.dataWrites == dataWrites);
+
+  //glyph 1 is the least recently used now
+  slot = glyphLCD(&g_lcd, glyphs[LCD_GLYPH_SLOTS]);
+
+  CHECK(slot == slots[1]);
+  CHECK(g_model.cgram[slot * 8] == 0x1F);
+  CHECK(g_model.cgram[(slot * 8) + 1] == 0x11);
+  CHECK(g_model.cgram[slots[0] * 8] == 0x01);
+
+  //NULL is no glyph, not a match for an empty slot or something to cache
+  invalidateGlyphsLCD(&g_lcd);
+  dataWrites = g_model.dataWrites;
+
+  CHECK(glyphLCD(&g_lcd, NULL) == ' ');
+  CHECK(g_model.dataWrites == dataWrites);
+  CHECK(glyphLCD(&g_lcd, glyphs[0]) == (LCD_GLYPH_SLOTS - 1));
+  CHECK(g_model.dataWrites == (dataWrites + 8));
+}
+
+//1 if printDecLCD of number prints p_text at the start of row 0, init sets precision 2 and width 2
+static int testDec(double number, const char *p_text)
+{
+  clearLCD(&g_lcd);
+  printDecLCD(&g_lcd, number);
+
+  return testRow(0, 0, p_text);
+}
+
+//1 if printFixedLCD of number prints p_text at the start of row 0
+static int testFixed(int32_t number, uint8_t fracBits, uint8_t precision, const char *p_text)
+{
+  clearLCD(&g_lcd);
+  printFixedLCD(&g_lcd, number, fracBits, precision, 0, 0);
+
+  return testRow(0, 0, p_text);
+}
+
+//formatters, fixed point rounds on the digit after the last one printed
+static void testFormat(const struct s_testConfig *p_config)
+{
+  testInit(p_config, 2, 16);
+
+  CHECK(testFixed(0x0380, 8, 2, "3.50 "));
+  CHECK(testFixed(-0x0380, 8, 2, "-3.50 "));
+  CHECK(testFixed(3, 2, 1, "0.8 "));
+  CHECK(testFixed(1, 8, 3, "0.004 "));
+  CHECK(testFixed(0xF6, 8, 1, "1.0 "));
+  CHECK(testFixed(-0xF6, 8, 1, "-1.0 "));
+  CHECK(testFixed(0x0180, 8, 0, "2 "));
+  CHECK(testFixed(0x017F, 8, 0, "1 "));
+  CHECK(testFixed(0x1580, 8, 1, "21.5 "));
+  CHECK(testFixed(0x0FFF, 8, 3, "15.996 "));
+
+  CHECK(testDec(3.14159, "3.14 "));
+  CHECK(testDec(-2.5, "-2.50 "));
+  CHECK(testDec(0.999, "1.00 "));
+  CHECK(testDec(42949672.96, "42949672.96 "));
+  CHECK(testDec(4294967295.0, "4294967295.00 "));
+  //past 32 bits of integer part, rounding into it, NaN and infinity
+  CHECK(testDec(5e9, "## "));
+  CHECK(testDec(4294967295.999, "## "));
+  CHECK(testDec(__builtin_nan(""), "## "));
+  CHECK(testDec(-__builtin_inf(), "## "));
+
+  clearLCD(&g_lcd);
+  printSignedLCD(&g_lcd, 42, 10, 5, LCD_FMT_ZERO | LCD_FMT_PLUS);
+  CHECK(testRow(0, 0, "+0042 "));
+
+  clearLCD(&g_lcd);
+  printHexLCD(&g_lcd, 0xBEEF, 6, LCD_FMT_ZERO | LCD_FMT_UPPER);
+  CHECK(testRow(0, 0, "00BEEF "));
+
+  clearLCD(&g_lcd);
+  printUnsignedLCD(&g_lcd, 40, 10, 4, LCD_FMT_LEFT);
+  printLCD(&g_lcd, "|");
+  CHECK(testRow(0, 0, "40  | "));
+}
+
+//1 if the marquee window shows p_text repeated every period characters from its position on
+static int testMarqueeShown(struct s_lcdMarquee *p_marquee, const char *p_text, uint8_t period)
+{
+  uint8_t col = 0;
+  uint8_t index = 0;
+  uint8_t length = strlen(p_text);
+
+  for(col = 0; col < p_marquee->width; col++)
+  {
+    index = (p_marquee->pos + col) % period;
+
+    if(hd44780ModelCell(&g_model, p_marquee->row, p_marquee->col + col, g_lcd.geometry.cols) != ((index < length) ? (uint8_t)p_text[index] : ' ')) return 0;
+  }
+
+  return 1;
+}
+
+//shift marquees on 16x2 with two commands a step, row mode where the shift can't work
+static void testMarquee(const struct s_testConfig *p_config)
+{
+  struct s_lcdMarquee top;
+  struct s_lcdMarquee bottom;
+  uint32_t instructions = 0;
+  uint32_t dataWrites = 0;
+  uint8_t step = 0;
+  uint8_t shown = 1;
+
+  testInit(p_config, 2, 16);
+
+  startMarqueeLCD(&g_lcd, &top, 0, 0, 0, "Hello marquee world", 3, LCD_MARQUEE_SHIFT);
+  startMarqueeLCD(&g_lcd, &bottom, 1, 0, 0, "short", 2, LCD_MARQUEE_SHIFT);
+
+  CHECK(top.mode == LCD_MARQUEE_SHIFT);
+
+  instructions = g_model.instructions;
+  dataWrites = g_model.dataWrites;
+
+  for(step = 0; step < 90; step++)
+  {
+    stepMarqueeLCD(&g_lcd, &top);
+    shown &= testMarqueeShown(&top, "Hello marquee world", 22);
+  }
+
+  CHECK(shown);
+  CHECK((g_model.dataWrites - dataWrites) == 90);
+  CHECK((g_model.instructions - instructions) <= 100);
+
+  //both rows share the display shift
+  for(step = 0; step < 40; step++)
+  {
+    stepMarqueeLCD(&g_lcd, &top);
+    stepMarqueeLCD(&g_lcd, &bottom);
+    shown &= testMarqueeShown(&top, "Hello marquee world", 22);
+    shown &= testMarqueeShown(&bottom, "short", 7);
+  }
+
+  CHECK(shown);
+
+  //home takes the shift back, the next step catches up
+  homeLCD(&g_lcd);
+  stepMarqueeLCD(&g_lcd, &top);
+
+  CHECK(testMarqueeShown(&top, "Hello marquee world", 22));
+
+  //4 rows can't shift, only the window changes
+  testInit(p_config, 4, 20);
+  printLCD(&g_lcd, "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+  startMarqueeLCD(&g_lcd, &top, 2, 4, 8, "Hello marquee world", 3, LCD_MARQUEE_SHIFT);
+
+  CHECK(top.mode == LCD_MARQUEE_ROW);
+
+  for(step = 0; step < 60; step++)
+  {
+    stepMarqueeLCD(&g_lcd, &top);
+    shown &= testMarqueeShown(&top, "Hello marquee world", 22);
+  }
+
+  CHECK(shown);
+  CHECK(testRow(0, 0, "ABCDEFGHIJKLMNOPQRST"));
+  CHECK(testRow(1, 0, "UVWXYZ "));
+  CHECK(testRow(2, 0, "    "));
+  CHECK(testRow(2, 12, "        "));
+}
+
+//1 if the model shows digits of p_big as the cells of its font, glyph cells by their CGRAM bitmap
+static int testBigShown(const struct s_lcdBig *p_big, const char *p_digits)
+{
+  const struct s_lcdBigFont *p_font = p_big->p_font;
+  uint8_t index = 0;
+  uint8_t cell = 0;
+  uint8_t code = 0;
+  uint8_t shown = 0;
+
+  for(index = 0; index < p_big->digits; index++)
+  {
+    for(cell = 0; cell < (p_font->cols * p_font->rows); cell++)
+    {
+      code = p_font->cells[p_digits[index] - '0'][cell];
+      shown = hd44780ModelCell(&g_model, p_big->row + (cell / p_font->cols), p_big->col + (index * (p_font->cols + 1)) + (cell % p_font->cols), g_lcd.geometry.cols);
+
+      if(code >= LCD_GLYPH_SLOTS)
+      {
+        if(shown != code) return 0;
+      }
+      else if((shown >= LCD_GLYPH_SLOTS) || memcmp(&g_model.cgram[shown * 8], p_font->glyph[code], 8))
+      {
+        return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
+//1 if the model shows a bar across at level, the partial cell by its CGRAM bitmap
+static int testBarShown(const struct s_lcdBar *p_bar, uint8_t level)
+{
+  uint8_t index = 0;
+  uint8_t pixels = 0;
+  uint8_t shown = 0;
+  uint8_t line = 0;
+
+  for(index = 0; index < p_bar->length; index++)
+  {
+    pixels = ((level > (index * 5)) ? (uint8_t)(level - (index * 5)) : 0);
+    shown = hd44780ModelCell(&g_model, p_bar->row, p_bar->col + index, g_lcd.geometry.cols);
+
+    if(pixels >= 5)
+    {
+      if(shown != 0xFF) return 0;
+    }
+    else if(!pixels)
+    {
+      if(shown != ' ') return 0;
+    }
+    else
+    {
+      if(shown >= LCD_GLYPH_SLOTS) return 0;
+
+      for(line = 0; line < 8; line++)
+      {
+        if(g_model.cgram[(shown * 8) + line] != ((0x1F << (5 - pixels)) & 0x1F)) return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
+//2x2 digits and a bar sharing CGRAM, each evicts glyphs of the other and has to redraw
+static void testWidgets(const struct s_testConfig *p_config)
+{
+  static const uint32_t numbers[] = {1234, 5678, 9012, 3456};
+  static const char *p_numbers[] = {"1234", "5678", "9012", "3456"};
+  static const uint8_t levels[] = {7, 13, 21, 4};
+  struct s_lcdBig big;
+  struct s_lcdBar bar;
+  uint32_t dataWrites = 0;
+  uint8_t index = 0;
+
+  testInit(p_config, 4, 20);
+
+  startBigLCD(&g_lcd, &big, &g_lcdBigFont2x2, 0, 0, 4);
+  printBigLCD(&g_lcd, &big, 1234, 0);
+
+  CHECK(testBigShown(&big, "1234"));
+
+  //nothing evicted, nothing written
+  dataWrites = g_model.dataWrites;
+  printBigLCD(&g_lcd, &big, 1234, 0);
+
+  CHECK(g_model.dataWrites == dataWrites);
+
+  startBarLCD(&g_lcd, &bar, 3, 0, 10, LCD_BAR_HORIZONTAL);
+
+  for(index = 0; index < 4; index++)
+  {
+    setBarLCD(&g_lcd, &bar, levels[index]);
+
+    CHECK(testBarShown(&bar, levels[index]));
+
+    //same number, the cells of evicted glyphs come back
+    printBigLCD(&g_lcd, &big, numbers[(index + 3) % 4], 0);
+
+    CHECK(testBigShown(&big, p_numbers[(index + 3) % 4]));
+
+    //same level, the partial cell comes back if the digits took its slot
+    setBarLCD(&g_lcd, &bar, levels[index]);
+
+    CHECK(testBarShown(&bar, levels[index]));
+
+    printBigLCD(&g_lcd, &big, numbers[index], 0);
+
+    CHECK(testBigShown(&big, p_numbers[index]));
+  }
+}
+
+//status line, wrapping log and menu windows on one shadow, scrolling only moves the log
+static void testWindows(const struct s_testConfig *p_config)
+{
+  static uint8_t shadow[4 * 20];
+  static uint8_t dirty[LCD_SHADOW_DIRTY_SIZE(4, 20)];
+  struct s_lcdWindow status;
+  struct s_lcdWindow log;
+  struct s_lcdWindow menu;
+
+  testInit(p_config, 4, 20);
+  attachShadowLCD(&g_lcd, shadow, dirty, 0, 0);
+
+  openWindowLCD(&g_lcd, &status, 0, 0, 1, 0, 0);
+  openWindowLCD(&g_lcd, &log, 1, 0, 3, 14, LCD_WIN_WRAP | LCD_WIN_SCROLL);
+  openWindowLCD(&g_lcd, &menu, 1, 14, 0, 0, 0);
+
+  //0 takes the rest of the screen
+  CHECK((menu.rows == 3) && (menu.cols == 6));
+
+  printWindowLCD(&g_lcd, &status, "Status: OK 12:00 extra cut");
+  printWindowLCD(&g_lcd, &menu, ">Run\n Stop\n Setup\nhidden");
+  printWindowLCD(&g_lcd, &log, "boot\nline two\n");
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(0, 0, "Status: OK 12:00 ext"));
+  CHECK(testRow(1, 0, "boot          >Run  "));
+  CHECK(testRow(2, 0, "line two       Stop "));
+  CHECK(testRow(3, 0, "               Setup"));
+
+  printWindowLCD(&g_lcd, &log, "third\nfourth is long wrapping");
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(0, 0, "Status: OK 12:00 ext"));
+  CHECK(testRow(1, 0, "third         >Run  "));
+  CHECK(testRow(2, 0, "fourth is long Stop "));
+  CHECK(testRow(3, 0, " wrapping      Setup"));
+
+  //form feed clears the window, carriage return goes back to its first column
+  printWindowLCD(&g_lcd, &status, "\fAB\rX");
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(0, 0, "XB                  "));
+
+  //filling the last line exactly doesn't scroll
+  printWindowLCD(&g_lcd, &log, "\f1\n2\n12345678901234");
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(1, 0, "1             >Run  "));
+  CHECK(testRow(3, 0, "12345678901234 Setup"));
+}
+
+//repairs of calls scrubLCD calls of budget us each, p_worst raised to the longest call
+static unsigned testScrubCalls(unsigned calls, uint16_t budget, uint64_t *p_worst)
+{
+  uint64_t startNs = 0;
+  unsigned repairs = 0;
+
+  for(; calls > 0; calls--)
+  {
+    startNs = hostStats.timeNs;
+    repairs += scrubLCD(&g_lcd, budget);
+
+    if(((hostStats.timeNs - startNs) / 1000) > *p_worst) *p_worst = (hostStats.timeNs - startNs) / 1000;
+  }
+
+  return repairs;
+}
+
+//scrub repairs flipped DDRAM and CGRAM bits and a lost bus mode, each call within its budget
+static void testScrub(const struct s_testConfig *p_config)
+{
+  static const uint8_t glyph[8] PROGMEM = {1, 2, 3, 4, 5, 6, 7, 8};
+  static uint8_t shadow[4 * 20];
+  static uint8_t dirty[LCD_SHADOW_DIRTY_SIZE(4, 20)];
+  uint64_t worst = 0;
+  uint8_t slot = 0;
+
+  //reads back over R/W only
+  if(!p_config->rw) return;
+
+  testInit(p_config, 4, 20);
+  attachShadowLCD(&g_lcd, shadow, dirty, 0, 0);
+
+  slot = glyphLCD(&g_lcd, glyph);
+  printShadowLCD(&g_lcd, 0, 0, "Hello scrubber");
+  putShadowLCD(&g_lcd, 1, 0, slot);
+  printShadowLCD(&g_lcd, 3, 5, "row three");
+  flushLCD(&g_lcd);
+  setCursorLCD(&g_lcd, 2, 3);
+
+  //a clean screen has nothing to repair
+  CHECK(testScrubCalls(200, 600, &worst) == 0);
+  CHECK(worst <= 600);
+
+  g_model.ddram[0x01] = 'X';
+  g_model.ddram[0x54 + 7] = 'Q';
+  g_model.cgram[(slot * 8) + 3] = 0x1F;
+
+  CHECK(testScrubCalls(300, 600, &worst) == 3);
+  CHECK(worst <= 600);
+  CHECK(testRow(0, 0, "Hello scrubber      "));
+  CHECK(testRow(3, 0, "     row three      "));
+  CHECK(g_model.cgram[(slot * 8) + 3] == 4);
+
+  //the cursor is where it was left
+  printLCD(&g_lcd, "ab");
+
+  CHECK(testRow(2, 0, "   ab               "));
+
+  //a controller that flipped bus width and lost its screen, the shadow has "ab" clean
+  g_model.functionSet ^= 0x10;
+  g_model.nibblePhase = 0;
+  memset(g_model.ddram, ' ', sizeof(g_model.ddram));
+
+  testScrubCalls(2000, 600, &worst);
+
+  CHECK(g_lcd.scrubRestarts == 1);
+  CHECK(worst <= 600);
+
+  //the restart invalidates the shadow, the flush puts the screen back
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(0, 0, "Hello scrubber      "));
+  CHECK(testRow(3, 0, "     row three      "));
+
+  //one line mode, the reset is spread over calls the same way
+  g_model.functionSet &= (uint8_t)~0x08;
+  memset(g_model.ddram, ' ', sizeof(g_model.ddram));
+
+  testScrubCalls(3000, 600, &worst);
+
+  CHECK(g_lcd.scrubRestarts == 2);
+  CHECK(worst <= 600);
+
+  flushLCD(&g_lcd);
+
+  CHECK(testRow(0, 0, "Hello scrubber      "));
+  CHECK(testRow(3, 0, "     row three      "));
+
+  //writes to the faulted controller count as violations in the model, not the driver's
+  g_model.busyViolations = 0;
+  g_model.timingViolations = 0;
+}
+
+//a busy flag that never clears falls back to fixed delays within the exec time and one poll
+static void testBusyTimeout(const struct s_testConfig *p_config)
+{
+  uint64_t startNs = 0;
+
+  if(!p_config->rw) return;
+
+  testInit(p_config, 2, 16);
+  printLCD(&g_lcd, "A");
+
+  g_model.busyUntilNs = ~0ULL;
+  startNs = hostStats.timeNs;
+  printLCD(&g_lcd, "B");
+
+  CHECK(g_lcd.busyCheck == 0);
+  //the exec time of the profile and a poll, the write and its fixed delay
+  CHECK((hostStats.timeNs - startNs) < (uint64_t)((50 + 5 + 30 + 50) * 1000));
+
+  g_model.busyUntilNs = 0;
+  printLCD(&g_lcd, "C");
+
+  CHECK(testRow(0, 0, "ABC"));
+
+  //writes on the stuck controller count as violations in the model, not the driver's
+  g_model.busyViolations = 0;
+  g_model.timingViolations = 0;
+}
+
+//more panels than LCD_GROUP_MAX, enables on PORTB then PORTC, all of them get flushed
+static void testGroup(const struct s_testConfig *p_config)
+{
+  static struct s_lcd lcds[LCD_GROUP_MAX + 2];
+  static struct s_hd44780Model models[LCD_GROUP_MAX + 2];
+  static uint8_t shadows[LCD_GROUP_MAX + 2][2 * 16];
+  static uint8_t dirty[LCD_GROUP_MAX + 2][LCD_SHADOW_DIRTY_SIZE(2, 16)];
+  struct s_lcd *p_group[LCD_GROUP_MAX + 2];
+  volatile uint8_t *p_ctrlPort = NULL;
+  uint8_t ena = 0;
+  uint8_t index = 0;
+  uint8_t col = 0;
+  char text[17];
+
+  //panels share the data and RS lines of the parallel bus and have no R/W
+  if(p_config->rw || (p_config->wiring != TEST_PARALLEL)) return;
+
+  hostReset();
+
+  for(index = 0; index < (LCD_GROUP_MAX + 2); index++)
+  {
+    p_ctrlPort = ((index < 7) ? &PORTB : &PORTC);
+    ena = ((index < 7) ? (index + 1) : (index - 6));
+
+    hd44780ModelInit(&models[index], HD44780_FOSC_HZ);
+    hd44780ModelWireParallel(&models[index], &PORTD, p_ctrlPort, TEST_RS, ena, 0xFF, p_config->mode);
+    hd44780ModelAttach(&models[index]);
+  }
+
+  setInitModeLCD(LCD_INIT_COLD);
+
+  for(index = 0; index < (LCD_GROUP_MAX + 2); index++)
+  {
+    p_ctrlPort = ((index < 7) ? &PORTB : &PORTC);
+    ena = ((index < 7) ? (index + 1) : (index - 6));
+
+    initLCD_customRW(&lcds[index], &PORTD, p_ctrlPort, TEST_RS, ena, LCD_NO_RW, p_config->mode, 32, 2, 2, 10);
+    attachShadowLCD(&lcds[index], shadows[index], dirty[index], 0, 0);
+
+    snprintf(text, sizeof(text), "panel %u", index);
+    printShadowLCD(&lcds[index], 1, 2, text);
+    p_group[index] = &lcds[index];
+  }
+
+  flushGroupLCD(p_group, LCD_GROUP_MAX + 2);
+
+  for(index = 0; index < (LCD_GROUP_MAX + 2); index++)
+  {
+    snprintf(text, sizeof(text), "panel %u", index);
+
+
+    for(col = 0; (text[col] != '\0') && (hd44780ModelCell(&models[index], 1, 2 + col, 16) == (uint8_t)text[col]); col++);
+
+    CHECK(text[col] == '\0');
+    CHECK((models[index].busyViolations == 0) && (models[index].timingViolations == 0));
+  }
+}
+
+//PCF8574 backpack at 400 kHz on a controller at the slow end of the profile, padding covers the settle time
+static void testTwiClock(const struct s_testConfig *p_config)
+{
+  static uint8_t batch[64];
+  static struct s_pcf8574Model expander;
+
+  //one bus, run it once
+  if(p_config->mode || p_config->rw || (p_config->wiring != TEST_PARALLEL)) return;
+
+  hostReset();
+
+  //data writes take the 50us of g_lcdTimingHD44780, 41us on a stock part
+  hd44780ModelInit(&g_model, (HD44780_FOSC_HZ * 41) / 50);
+  pcf8574ModelInit(&expander, 0x27, 400000UL);
+  pcf8574ModelAttach(&expander);
+  hd44780ModelWirePcf8574(&g_model, &expander);
+  hd44780ModelAttach(&g_model);
+
+  setInitModeLCD(LCD_INIT_COLD);
+  initLCD_twi(&g_lcd, pcf8574ModelSend, 0x27, batch, sizeof(batch), 32, 2, 2, 10);
+  setTwiClockLCD(&g_lcd, 400000UL);
+
+  CHECK(g_lcd.twiPad == 1);
+
+  //init ran before the clock was known
+  g_model.busyViolations = 0;
+  g_model.timingViolations = 0;
+
+  printLCD(&g_lcd, "settled at 400k");
+  setCursorLCD(&g_lcd, 1, 0);
+  printLCD(&g_lcd, "second row");
+
+  CHECK(testRow(0, 0, "settled at 400k"));
+  CHECK(testRow(1, 0, "second row"));
+}
+
+//data lines on more ports than a map takes, the handle is safe to use and writes nothing
+static void testMapPorts(const struct s_testConfig *p_config)
+{
+  static struct s_lcdMap map;
+  volatile uint8_t *p_ports[4] = {&PORTB, &PORTC, &PORTD, &PORTD};
+  uint8_t line = 0;
+
+  //no bus of its own, run it once
+  if(p_config->mode || p_config->rw || (p_config->wiring != TEST_PARALLEL)) return;
+
+  testInit(p_config, 2, 16);
+
+  for(line = 4; line < 8; line++)
+  {
+    map.p_data[line] = p_ports[line - 4];
+    map.dataBit[line] = line;
+  }
+
+  g_model.instructions = 0;
+  g_model.dataWrites = 0;
+
+  initLCD_map(&g_lcd, &map, &PORTB, TEST_RS, TEST_ENA, LCD_NO_RW, 0, 32, 2, 2, 10);
+  printLCD(&g_lcd, "nowhere");
+  setCursorLCD(&g_lcd, 1, 3);
+  clearLCD(&g_lcd);
+
+  CHECK(g_lcd.geometry.cols == 16);
+  CHECK((g_model.instructions == 0) && (g_model.dataWrites == 0));
+}
+
+//writes land in the queue and show up once tickQueueLCD drained it
+static void testQueueTick(const struct s_testConfig *p_config)
+{
+  uint16_t queue[64];
+
+  testInit(p_config, 2, 16);
+  attachQueueLCD(&g_lcd, queue, 64, LCD_QUEUE_DROP);
+
+  printLCD(&g_lcd, "STALE");
+  clearLCD(&g_lcd);
+  printLCD(&g_lcd, "TICK");
+  setCursorLCD(&g_lcd, 1, 3);
+  printLCD(&g_lcd, "QUEUED");
+
+  //nothing went out yet
+  CHECK(queueDepthLCD(&g_lcd) > 0);
+  CHECK(testRow(0, 0, "                "));
+
+  while(queueDepthLCD(&g_lcd))
+  {
+    _delay_us(LCD_QUEUE_TICK_US);
+    tickQueueLCD(&g_lcd);
+  }
+
+  CHECK(testRow(0, 0, "TICK            "));
+  CHECK(testRow(1, 0, "   QUEUED       "));
+
+  attachQueueLCD(&g_lcd, NULL, 0, LCD_QUEUE_DROP);
+}
+
+//same with a main loop polling serviceLCD, it only sends once the display is done
+static void testQueueService(const struct s_testConfig *p_config)
+{
+  uint16_t queue[64];
+  uint16_t calls = 0;
+
+  testInit(p_config, 2, 16);
+  attachQueueLCD(&g_lcd, queue, 64, LCD_QUEUE_DROP);
+
+  printLCD(&g_lcd, "STALE");
+  clearLCD(&g_lcd);
+  printLCD(&g_lcd, "POLL");
+  setCursorLCD(&g_lcd, 1, 5);
+  printLCD(&g_lcd, "SERVICE");
+
+  CHECK(testRow(0, 0, "                "));
+
+  while(serviceLCD(&g_lcd, (uint16_t)(hostStats.timeNs / 1000)) && (calls < 10000))
+  {
+    _delay_us(5);
+    calls++;
+  }
+
+  CHECK(queueDepthLCD(&g_lcd) == 0);
+  CHECK(testRow(0, 0, "POLL            "));
+  CHECK(testRow(1, 0, "     SERVICE    "));
+
+  attachQueueLCD(&g_lcd, NULL, 0, LCD_QUEUE_DROP);
+}
+
+//\n starts the next row, \f clears and starts over at home
+static void testStream(const struct s_testConfig *p_config)
+{
+  FILE *p_stream = NULL;
+
+  testInit(p_config, 4, 20);
+
+  p_stream = openStreamLCD(&g_lcd, NULL);
+
+  CHECK(p_stream != NULL);
+
+  if(p_stream == NULL) return;
+
+  fprintf(p_stream, "GONE\fT=%d\nRH=%u%%\n\nEND", -5, 40U);
+  fclose(p_stream);
+
+  CHECK(testRow(0, 0, "T=-5                "));
+  CHECK(testRow(1, 0, "RH=40%              "));
+  CHECK(testRow(2, 0, "                    "));
+  CHECK(testRow(3, 0, "END                 "));
+}
+
+//field callback for testScreen, prints the field number width times
+static void testField(struct s_lcd *p_lcd, uint8_t field, uint8_t width)
+{
+  for(; width > 0; width--) printSpecialLCD(p_lcd, '0' + field);
+}
+
+//flash strings and screen programs, glyphs are uploaded on the way
+static void testScreen(const struct s_testConfig *p_config)
+{
+  static const uint8_t glyph[8] PROGMEM = {0x0E, 0x11, 0x11, 0x0E};
+  static const uint8_t * const glyphs[1] = {glyph};
+  static const uint8_t program[] PROGMEM =
+  {
+    LCD_SCR_CLEAR, 'V', ':', LCD_SCR_FIELD_OF(3, 4), LCD_SCR_GLYPH_OF(0),
+    LCD_SCR_AT(1, 10), LCD_SCR_RAW, 0x10, 'O', 'K', LCD_SCR_FIELD_OF(1, 2), LCD_SCR_END
+  };
+  static const uint8_t outside[] PROGMEM = {LCD_SCR_AT(1, 0), '<', LCD_SCR_GLYPH_OF(1), '>', LCD_SCR_END};
+  uint8_t slot = 0;
+  uint32_t dataWrites = 0;
+
+  testInit(p_config, 2, 16);
+
+  printLCD_P(&g_lcd, PSTR("FLASH STRING WRAPS"));
+
+  CHECK(testRow(0, 0, "FLASH STRING WRA"));
+  CHECK(testRow(1, 0, "PS              "));
+
+  runScreenLCD(&g_lcd, program, glyphs, 1, testField);
+
+  slot = hd44780ModelCell(&g_model, 0, 6, 16);
+
+  CHECK(testRow(0, 0, "V:3333"));
+  CHECK(slot < LCD_GLYPH_SLOTS);
+  CHECK(g_model.cgram[slot * 8] == 0x0E);
+  CHECK(g_model.cgram[(slot * 8) + 1] == 0x11);
+  CHECK(testRow(0, 7, "         "));
+  CHECK(hd44780ModelCell(&g_model, 1, 10, 16) == 0x10);
+  CHECK(testRow(1, 11, "OK11 "));
+
+  //no callback leaves the field blank
+  runScreenLCD(&g_lcd, program, glyphs, 1, NULL);
+
+  CHECK(testRow(0, 0, "V:    "));
+  CHECK(hd44780ModelCell(&g_model, 0, 6, 16) == slot);
+  CHECK(testRow(1, 11, "OK   "));
+
+  //an index past the table is a blank and uploads nothing
+  dataWrites = g_model.dataWrites;
+  runScreenLCD(&g_lcd, outside, glyphs, 1, NULL);
+
+  CHECK(testRow(1, 0, "< >"));
+  CHECK(g_model.dataWrites == (dataWrites + 3));
+}
+
+//a warm init keeps the screen and skips the power on waits, a probe only trusts a controller that answers
+static void testWarmInit(const struct s_testConfig *p_config)
+{
+  uint64_t startNs = 0;
+
+  testInit(p_config, 2, 16);
+  printLCD(&g_lcd, "KEEP ME");
+
+  CHECK(g_lcd.warm == 0);
+
+  startNs = hostStats.timeNs;
+  setInitModeLCD(LCD_INIT_WARM);
+  testStart(p_config, 2, 16);
+
+  CHECK(g_lcd.warm == 1);
+  CHECK((hostStats.timeNs - startNs) < 10000000ULL);
+  CHECK(testRow(0, 0, "KEEP ME "));
+
+  //cursor went home
+  printLCD(&g_lcd, "WARM");
+
+  CHECK(testRow(0, 0, "WARM ME "));
+
+  if(p_config->rw)
+  {
+    setInitModeLCD(LCD_INIT_PROBE);
+    testStart(p_config, 2, 16);
+
+    CHECK(g_lcd.warm == 1);
+    CHECK(testRow(0, 0, "WARM ME "));
+
+    //a controller that just powered up fails the probe and gets the full sequence
+    testWire(p_config);
+    testStart(p_config, 2, 16);
+
+    CHECK(g_lcd.warm == 0);
+
+    printLCD(&g_lcd, "COLD");
+
+    CHECK(testRow(0, 0, "COLD    "));
+  }
+
+  setInitModeLCD(LCD_INIT_COLD);
+}
+
+//40x2 runs both rows the full 40 columns, printing wraps from column 39 to row 1
+static void testGeometry40x2(const struct s_testConfig *p_config)
+{
+  testInit(p_config, 2, 40);
+  setGeometryLCD(&g_lcd, &g_lcdGeometry40x2);
+
+  CHECK(g_lcd.geometry.rows == 2);
+  CHECK(g_lcd.geometry.cols == 40);
+
+  setCursorLCD(&g_lcd, 0, 36);
+  printLCD(&g_lcd, "EDGEWRAP");
+
+  CHECK(testRow(0, 36, "EDGE"));
+  CHECK(testRow(1, 0, "WRAP "));
+
+  setCursorLCD(&g_lcd, 1, 39);
+  printLCD(&g_lcd, "Z");
+
+  CHECK(hd44780ModelCell(&g_model, 1, 39, 40) == 'Z');
+}
+
+static const struct s_testConfig g_configs[] =
+{
+  {"4bit",          0, 0, TEST_PARALLEL},
+  {"8bit",          1, 0, TEST_PARALLEL},
+  {"4bit_busy",     0, 1, TEST_PARALLEL},
+  {"8bit_busy",     1, 1, TEST_PARALLEL},
+  {"4bit_map",      0, 0, TEST_MAP},
+  {"8bit_map",      1, 0, TEST_MAP},
+  {"4bit_busy_map", 0, 1, TEST_MAP},
+  {"4bit_spi",      0, 0, TEST_HC595},
+  {"8bit_spi",      1, 0, TEST_HC595},
+  {"pcf8574",       0, 0, TEST_PCF8574},
+  {"pcf8574_400k",  0, 0, TEST_PCF8574_FAST},
+};
+
+static const struct s_testCase g_cases[] =
+{
+  {"print",  testPrint},
+  {"shadow", testShadow},
+  {"cursor", testCursor},
+  {"glyphs", testGlyphs},
+  {"format", testFormat},
+  {"marquee", testMarquee},
+  {"widgets", testWidgets},
+  {"windows", testWindows},
+  {"scrub", testScrub},
+  {"busy_timeout", testBusyTimeout},
+  {"group", testGroup},
+  {"twi_clock", testTwiClock},
+  {"map_ports", testMapPorts},
+  {"queue_tick", testQueueTick},
+  {"queue_service", testQueueService},
+  {"stream", testStream},
+  {"screen", testScreen},
+  {"warm_init", testWarmInit},
+  {"geometry_40x2", testGeometry40x2},
+};
+
+int main(void)
+{
+  size_t config = 0;
+  size_t test = 0;
+
+  for(config = 0; config < (sizeof(g_configs) / sizeof(g_configs[0])); config++)
+  {
+    for(test = 0; test < (sizeof(g_cases) / sizeof(g_cases[0])); test++)
+    {
+      gp_case = g_cases[test].p_name;
+      gp_config = g_configs[config].p_name;
+
+      g_cases[test].run(&g_configs[config]);
+
+      CHECK((g_model.busyViolations == 0) && (g_model.timingViolations == 0));
+    }
+  }
+
+  printf("%u checks, %u failed\n", g_checks, g_failures);
+
+  return (g_failures != 0);
+}